@@ -0,0 +1,82 @@
+#include "../src/Display/FrameScaler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/*  times FrameScaler for every filter at 3x, 5x and 8x, single-threaded and with one band per hardware thread
+    (at most 8, as the display uses). Reports FrameScaler::lastDuration averaged over the frames and its minimum.
+    usage: FrameScalerBench [frames]
+*/
+
+static constexpr uint8_t gScales[] = { 3, 5, 8 };
+static constexpr uint8_t gMaxThreads = 8;
+
+static const char* filterName(const FrameScaler::Filter filter)
+{
+    switch (filter)
+    {
+        case FrameScaler::Filter::nearest: return "nearest";
+        case FrameScaler::Filter::scanlines: return "scanline";
+        case FrameScaler::Filter::edge_aware: return "edge";
+    }
+
+    return "";
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t frameCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 200;
+    if (frameCount == 0) return EXIT_FAILURE;
+
+    // diagonal stripes and flat areas, so the edge-aware filter takes both of its paths
+    DisplayData frame {};
+    for (uint32_t y = 0; y < gDisplayHeight; y++)
+    {
+        for (uint32_t x = 0; x < gDisplayWidth; x++)
+        {
+            const bool stripe = ((x + y) / 4) % 2 == 0;
+            frame[y * gDisplayWidth + x] = (x < gDisplayWidth / 2 && stripe) ? 0xFF306230 : 0xFF9BBC0F;
+        }
+    }
+
+    const uint8_t hostThreads = static_cast<uint8_t>(std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<unsigned>(gMaxThreads)));
+    std::vector<uint8_t> threadCounts { 1 };
+    if (hostThreads > 1) threadCounts.push_back(hostThreads);
+
+    for (const uint8_t threadCount : threadCounts)
+    {
+        FrameScaler scaler(threadCount);
+
+        for (const FrameScaler::Filter filter : { FrameScaler::Filter::nearest, FrameScaler::Filter::scanlines, FrameScaler::Filter::edge_aware })
+        {
+            for (const uint8_t scale : gScales)
+            {
+                scaler.setFilter(filter, scale);
+
+                std::vector<uint32_t> output(static_cast<size_t>(scaler.outputWidth()) * scaler.outputHeight());
+                const size_t pitch = scaler.outputWidth() * sizeof(uint32_t);
+
+                // warms up the workers and the output pages
+                scaler.scaleFrame(frame, output.data(), pitch);
+
+                std::chrono::nanoseconds total {};
+                std::chrono::nanoseconds fastest = std::chrono::nanoseconds::max();
+                for (uint32_t index = 0; index < frameCount; index++)
+                {
+                    scaler.scaleFrame(frame, output.data(), pitch);
+                    total += scaler.lastDuration();
+                    fastest = std::min(fastest, scaler.lastDuration());
+                }
+
+                std::printf("%-8s %ux (%4u x %4u), %u thread(s): %8.1f us per frame, fastest %8.1f us\n", filterName(filter), scale,
+                    scaler.outputWidth(), scaler.outputHeight(), threadCount, total.count() / 1000.0 / frameCount, fastest.count() / 1000.0);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
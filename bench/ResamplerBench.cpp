@@ -0,0 +1,65 @@
+#include "../src/Audio/Resampler.h"
+#include "../src/Hardware/APU/ApuDefines.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*  resampling throughput from the APU rate to 48 kHz at every quality, in frame-sized blocks as the front end
+    feeds them. usage: ResamplerBench [seconds of audio]
+*/
+
+static constexpr uint32_t gOutputRate = 48000;
+static constexpr size_t gBlockSize = 1097;
+
+int main(int argc, char** argv)
+{
+    const uint32_t audioSeconds = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 60;
+    if (audioSeconds == 0) return EXIT_FAILURE;
+
+    // square-ish waves with some noise, the kind of signal the APU produces
+    const size_t inputCount = static_cast<size_t>(apuSampleRate) * audioSeconds;
+    std::vector<int16_t> input(inputCount * 2);
+    uint32_t random = 0x9E3779B9;
+    for (size_t index = 0; index < inputCount; index++)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        input[index * 2] = static_cast<int16_t>(((index / 75) % 2 ? 8000 : -8000) + static_cast<int16_t>(random & 0x3FF));
+        input[index * 2 + 1] = static_cast<int16_t>(((index / 110) % 2 ? 6000 : -6000) + static_cast<int16_t>(random >> 22));
+    }
+
+    const std::pair<Resampler::Quality, const char*> qualities[] =
+    {
+        { Resampler::Quality::fast, "fast" },
+        { Resampler::Quality::balanced, "balanced" },
+        { Resampler::Quality::best, "best" }
+    };
+
+    std::vector<int16_t> output;
+    output.reserve((static_cast<size_t>(gOutputRate) * audioSeconds + gBlockSize) * 2);
+
+    for (const auto& [quality, name] : qualities)
+    {
+        Resampler resampler;
+        resampler.configure(apuSampleRate, gOutputRate, quality);
+        output.clear();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < inputCount; offset += gBlockSize)
+        {
+            resampler.process(&input[offset * 2], std::min(gBlockSize, inputCount - offset), output);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const double outputPairs = static_cast<double>(output.size() / 2);
+        std::printf("%-8s %u s of audio in %.3f s: %.2f M input pairs/s, %.2f M output pairs/s, %.0fx real time\n", name,
+                    audioSeconds, seconds, inputCount / seconds / 1e6, outputPairs / seconds / 1e6, audioSeconds / seconds);
+    }
+
+    return EXIT_SUCCESS;
+}
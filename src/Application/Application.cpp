@@ -1,30 +1,529 @@
 #include "Application.h"
 
-#include "../Hardware/CPU/CpuCore/CpuCore.h"
+#include "../Audio/AudioManager.h"
+#include "../Display/DisplayManager.h"
+#include "../Hardware/Joypad/Joypad.h"
 
-Application::Application()
+#include "SDL.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+
+// while running, new frames are checked for at this rate; a paused emulator only wakes up for input
+static constexpr std::chrono::milliseconds gRunningInputTimeout { 2 };
+static constexpr std::chrono::milliseconds gPausedInputTimeout { 100 };
+
+static constexpr uint32_t gMachineCyclesPerFrame = cyclesPerFrame / cyclesPerMachineCycle;
+
+static int64_t hostTimeNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Application::Application(const bool headless)
 {
-    mCpuCore = std::make_unique<CpuCore>();
+    mMachine = std::make_unique<Machine>();
+    mMachine->memory().setColorConversion(mPixelFormat, ColorTable::ColorCorrection::none);
+    mMachine->ppu().setDisplayBuffer(mFrameBuffers.backBuffer().displayData, mFrameBuffers.backIndex());
+
+    if (headless) return;
+
+    // SDL has to be driven from the main thread
+    mDisplayManager = std::make_unique<DisplayManager>();
+    mDisplayManager->start(mPixelFormat);
+
+    // without an audio device the game simply runs silent
+    mAudioManager = std::make_unique<AudioManager>();
+    if (mAudioManager->start(AudioManager::defaultSampleRate))
+    {
+        mResampler.configure(mMachine->apu().sampleRate(), mAudioManager->sampleRate(), Resampler::Quality::balanced);
+    }
+    else
+    {
+        mAudioManager.reset();
+    }
 }
 
 Application::~Application()
-{}
+{
+    stopEmulation();
+}
 
 void Application::loop()
 {
-    mCpuCore->handleCurrentInstruction();
+    if (!mDisplayManager)
+    {
+        // nothing to present or poll without a window
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return;
+    }
+
+    // presenting waits for vsync. Without a new frame there is nothing to present, so this thread sleeps
+    // until input arrives instead
+    if (mFrameBuffers.acquire())
+    {
+        processInput();
+        mDisplayManager->renderImage(mFrameBuffers.frontBuffer());
+    }
+    else
+    {
+        processInput(mPaused ? gPausedInputTimeout : gRunningInputTimeout);
+    }
+}
+
+void Application::processInput(const std::chrono::milliseconds timeout)
+{
+    SDL_Event event;
+    bool hasEvent = timeout.count() > 0 ? SDL_WaitEventTimeout(&event, static_cast<int>(timeout.count())) != 0 : SDL_PollEvent(&event) != 0;
+
+    for (; hasEvent; hasEvent = SDL_PollEvent(&event) != 0)
+    {
+        if (event.type == SDL_QUIT)
+        {
+            mTerminate = true;
+        }
+        else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0 && event.key.keysym.sym == SDLK_TAB)
+        {
+            // fast forward only lasts while the key is held
+            if (event.type == SDL_KEYDOWN)
+            {
+                mFramePacer.setSpeed(FramePacer::SpeedMode::unlimited);
+            }
+            else
+            {
+                mFramePacer.setSpeed(mSelectedSpeedMode, mSelectedMultiplier);
+            }
+        }
+        else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0 && event.key.keysym.sym == SDLK_r)
+        {
+            mRewindHeld = event.type == SDL_KEYDOWN;
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.repeat == 0 && event.key.keysym.sym == SDLK_p)
+        {
+            setPaused(!mPaused);
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.repeat == 0 && (event.key.keysym.sym == SDLK_F5 || event.key.keysym.sym == SDLK_F8))
+        {
+            // the machine belongs to the emulation thread; it saves or loads before its next frame
+            mStateRequest = event.key.keysym.sym == SDLK_F5 ? StateRequest::save : StateRequest::load;
+        }
+        else if (event.type == SDL_KEYDOWN && event.key.repeat == 0 && event.key.keysym.sym == SDLK_F1)
+        {
+            resetSystem();
+        }
+        else if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0)
+        {
+            handleKey(event.key.keysym.sym, event.type == SDL_KEYDOWN);
+        }
+    }
 }
 
-void Application::processInput()
+void Application::handleKey(const int32_t key, const bool pressed)
 {
-    // TODO implement opcode handling
+    Joypad::Button button;
+    switch (key)
+    {
+        case SDLK_RIGHT: button = Joypad::Button::right; break;
+        case SDLK_LEFT: button = Joypad::Button::left; break;
+        case SDLK_UP: button = Joypad::Button::up; break;
+        case SDLK_DOWN: button = Joypad::Button::down; break;
+        case SDLK_x: button = Joypad::Button::a; break;
+        case SDLK_z: button = Joypad::Button::b; break;
+        case SDLK_BACKSPACE: button = Joypad::Button::select; break;
+        case SDLK_RETURN: button = Joypad::Button::start; break;
+        default: return;
+    }
+
+    const uint8_t mask = 1 << static_cast<uint8_t>(button);
+    const uint8_t buttons = pressed ? (mButtons | mask) : (mButtons & ~mask);
+    if (buttons == mButtons) return;
+
+    // a full queue means the emulation is stalled; the change is then dropped and the next one carries the full state
+    if (mInputQueue.push(InputEvent { hostTimeNow(), buttons }) == false) return;
+    mButtons = buttons;
 }
 
 void Application::loadRom(const std::string& fileName)
 {
-    // TODO actually load
+    // a missing ROM leaves the machine running on open bus
+    mMachine->loadRom(fileName);
+    mMachine->reset();
+    mStatePath = fileName + ".state";
+
+    startEmulation();
+}
+
+bool Application::setBootRom(const std::string& fileName)
+{
+    std::shared_ptr<const Machine::Rom> bootRom = Machine::readRom(fileName);
+    if (!bootRom || (bootRom->data.size() != bootRomSize && bootRom->data.size() != colorBootRomSize)) return false;
+
+    mMachine->setBootRom(std::move(bootRom));
+    return true;
+}
+
+void Application::resetSystem()
+{
+    // the machine belongs to the emulation thread
+    mStateRequest = StateRequest::reset;
+}
+
+void Application::setColorCorrection(const bool enabled)
+{
+    mMachine->memory().setColorConversion(mPixelFormat, enabled ? ColorTable::ColorCorrection::lcd : ColorTable::ColorCorrection::none);
+}
+
+void Application::setScaling(const FrameScaler::Filter filter, const uint8_t scale)
+{
+    if (mDisplayManager) mDisplayManager->setScaling(filter, scale);
+}
+
+bool Application::openFrameStream(const std::string& fileName, const FrameStreamer::Format format, const bool skipDuplicates)
+{
+    mFrameStreamer = std::make_unique<FrameStreamer>();
+    if (mFrameStreamer->open(fileName, format, mPixelFormat, skipDuplicates)) return true;
+
+    mFrameStreamer.reset();
+    return false;
+}
+
+void Application::setFrameLimit(const uint64_t frameCount)
+{
+    mFrameLimit = frameCount;
+}
+
+void Application::setSpeed(const FramePacer::SpeedMode mode, const uint8_t multiplier)
+{
+    mSelectedSpeedMode = mode;
+    mSelectedMultiplier = multiplier;
+
+    mFramePacer.setSpeed(mode, multiplier);
+}
+
+void Application::setRunAhead(const uint8_t frames)
+{
+    mRunAheadFrames = frames;
+}
+
+void Application::recordMovie(const std::string& fileName)
+{
+    mMovieMode = MovieMode::record;
+    mMoviePath = fileName;
+}
+
+bool Application::playMovie(const std::string& fileName, const uint64_t startFrame)
+{
+    if (mMovie.load(fileName) == false) return false;
+
+    mMovieMode = MovieMode::play;
+    mMovieFrame = startFrame;
+    return true;
+}
+
+void Application::setRewindCapacity(const size_t bytes)
+{
+    mRewindBuffer.setCapacity(bytes);
+}
+
+void Application::setPaused(const bool paused)
+{
+    {
+        std::lock_guard<std::mutex> lock(mPauseMutex);
+        mPaused = paused;
+    }
+    mPauseCondition.notify_one();
+}
+
+bool Application::isPaused() const
+{
+    return mPaused;
+}
+
+bool Application::isRunning() const
+{
+    return mTerminate == false;
+}
+
+void Application::startEmulation()
+{
+    if (mGameLoopThread.joinable()) return;
+
+    mTerminate = false;
+    mFramePacer.reset();
+    mFrameStartTime = std::chrono::steady_clock::now();
+
+    // the machine is still idle here
+    if (mMovieMode == MovieMode::record)
+    {
+        mMovie.startRecording(*mMachine);
+    }
+    else if (mMovieMode == MovieMode::play && mMovie.seek(*mMachine, mMovieFrame) == false)
+    {
+        mMovieMode = MovieMode::none;
+    }
+
+    mGameLoopThread = std::thread(&Application::emulationLoop, this);
+}
+
+void Application::stopEmulation()
+{
+    {
+        std::lock_guard<std::mutex> lock(mPauseMutex);
+        mTerminate = true;
+    }
+    mPauseCondition.notify_one();
+
+    if (mGameLoopThread.joinable())
+    {
+        mGameLoopThread.join();
+    }
+
+    // writes out whatever is still queued
+    if (mFrameStreamer) mFrameStreamer->close();
+
+    if (mMovieMode == MovieMode::record) mMovie.save(mMoviePath);
+}
+
+void Application::emulationLoop()
+{
+    // pausing and termination are only checked in between frames
     while (mTerminate == false)
     {
-        loop();
+        if (mPaused)
+        {
+            waitWhilePaused();
+            continue;
+        }
+
+        handleStateRequest();
+
+        // a movie only holds frames that ran forward
+        if (mRewindHeld && mMovieMode == MovieMode::none)
+        {
+            rewindFrame();
+            continue;
+        }
+        if (mRewinding)
+        {
+            mRewindBuffer.endRewind();
+            mRewinding = false;
+        }
+
+        collectInput();
+        if (mMovieMode == MovieMode::play)
+        {
+            playMovieFrame();
+        }
+        else
+        {
+            if (mMovieMode == MovieMode::record) mMovie.recordFrame(*mMachine, mPendingInput.data(), mPendingInput.size());
+            if (mMachine->runFrame(mPendingInput.data(), mPendingInput.size())) frameCompleted();
+        }
+    }
+}
+
+void Application::playMovieFrame()
+{
+    // live input is ignored until the movie ends
+    if (mMovieFrame >= mMovie.frameCount())
+    {
+        mMovieMode = MovieMode::none;
+        return;
+    }
+
+    size_t changeCount = 0;
+    const Machine::ButtonChange* changes = mMovie.frameChanges(mMovieFrame++, changeCount);
+    if (mMachine->runFrame(changes, changeCount)) frameCompleted();
+}
+
+void Application::collectInput()
+{
+    // the events were collected while the previous frame ran. They are replayed at the same relative position
+    // within this frame, which keeps their spacing and delays them by at most one frame
+    const auto frameStart = std::chrono::steady_clock::now();
+    const int64_t previousStart = std::chrono::duration_cast<std::chrono::nanoseconds>(mFrameStartTime.time_since_epoch()).count();
+    const int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(frameStart - mFrameStartTime).count();
+    mFrameStartTime = frameStart;
+
+    mPendingInput.clear();
+
+    InputEvent event;
+    while (mInputQueue.pop(event))
+    {
+        int64_t machineCycle = 0;
+        if (elapsed > 0)
+        {
+            machineCycle = std::clamp<int64_t>((event.hostTime - previousStart) * gMachineCyclesPerFrame / elapsed, 0, gMachineCyclesPerFrame - 1);
+        }
+
+        mPendingInput.push_back({ static_cast<uint32_t>(machineCycle), event.buttons });
+    }
+}
+
+void Application::waitWhilePaused()
+{
+    std::unique_lock<std::mutex> lock(mPauseMutex);
+    mPauseCondition.wait(lock, [this] { return mPaused == false || mTerminate; });
+
+    // the time spent paused must not be caught up afterwards
+    mFramePacer.reset();
+}
+
+void Application::frameCompleted()
+{
+    mEmulatedFrames++;
+    outputAudio();
+
+    // the state after every real frame feeds the rewind history and run-ahead
+    if (mRewindBuffer.capacity() > 0 || mRunAheadFrames > 0) mMachine->saveState(mFrameState);
+    if (mRewindBuffer.capacity() > 0) mRewindBuffer.push(mFrameState);
+
+    // the frame that is shown lies in the future
+    if (mRunAheadFrames > 0) runAhead();
+
+    // skipped frames never reach the presentation
+    if (mMachine->ppu().lastFrameStatistics().frameSkipped == false)
+    {
+        publishFrame();
+    }
+
+    if (mFrameLimit != 0 && mEmulatedFrames >= mFrameLimit)
+    {
+        mTerminate = true;
+        return;
+    }
+
+    // waits for the next frame to be due, unless running unlimited. A stream needs every frame
+    const bool drawNextFrame = mFramePacer.frameCompleted();
+    mDrawRunAhead = drawNextFrame || mFrameStreamer;
+    mMachine->ppu().setFrameSkipping(mRunAheadFrames > 0 || (drawNextFrame == false && !mFrameStreamer));
+}
+
+void Application::outputAudio()
+{
+    Apu& apu = mMachine->apu();
+    apu.endFrame();
+
+    // nobody would hear the samples without a device or faster than normal; the APU then only keeps its
+    // registers up to date. Takes effect with the next frame
+    const bool audible = mAudioManager && mFramePacer.speedMode() == FramePacer::SpeedMode::normal;
+    apu.setSynthesisEnabled(audible);
+
+    const uint32_t sampleCount = apu.samplesAvailable();
+    if (audible == false)
+    {
+        apu.discardSamples(sampleCount);
+        return;
+    }
+
+    mAudioSamples.resize(sampleCount * 2);
+    apu.readSamples(mAudioSamples.data(), sampleCount);
+
+    mResampledSamples.clear();
+    const size_t resampledCount = mResampler.process(mAudioSamples.data(), sampleCount, mResampledSamples);
+
+    mAudioManager->queueSamples(mResampledSamples.data(), static_cast<uint32_t>(resampledCount));
+    mResampler.setRatioAdjustment(mAudioManager->rateAdjustment());
+}
+
+void Application::runAhead()
+{
+    // nobody hears the frames that get thrown away
+    Apu& apu = mMachine->apu();
+    const bool synthesisEnabled = apu.synthesisEnabled();
+    apu.setSynthesisEnabled(false);
+
+    // the buttons stay as they are at the end of the real frame
+    mPendingInput.clear();
+
+    for (uint8_t frame = 1; frame <= mRunAheadFrames; frame++)
+    {
+        mMachine->ppu().setFrameSkipping(frame < mRunAheadFrames || mDrawRunAhead == false);
+        if (mMachine->runFrame() == false) break;
+
+        apu.endFrame();
+        apu.discardSamples(apu.samplesAvailable());
+    }
+
+    // re-enabling clears the sample buffers, so it has to happen before they are restored
+    apu.setSynthesisEnabled(synthesisEnabled);
+    mMachine->loadState(mFrameState.data(), mFrameState.size());
+}
+
+void Application::rewindFrame()
+{
+    if (mRewinding == false)
+    {
+        mRewindBuffer.beginRewind();
+        mRewinding = true;
+    }
+
+    // at the end of the history the picture simply stays
+    if (mRewindBuffer.popState(mRewindState) && mMachine->loadState(mRewindState.data(), mRewindState.size()))
+    {
+        // shows the frame that followed the state, without sound. Releasing the key continues from there
+        Apu& apu = mMachine->apu();
+        apu.setSynthesisEnabled(false);
+        mMachine->ppu().setFrameSkipping(false);
+
+        if (mMachine->runFrame())
+        {
+            apu.endFrame();
+            apu.discardSamples(apu.samplesAvailable());
+            publishFrame();
+        }
     }
-}
\ No newline at end of file
+
+    mFramePacer.frameCompleted();
+}
+
+void Application::handleStateRequest()
+{
+    const StateRequest request = mStateRequest.exchange(StateRequest::none);
+    if (request == StateRequest::none) return;
+
+    // loading or resetting would break the movie apart
+    if (request != StateRequest::save && mMovieMode != MovieMode::none) return;
+
+    if (request == StateRequest::reset)
+    {
+        mMachine->reset();
+        return;
+    }
+
+    if (mStatePath.empty()) return;
+
+    if (request == StateRequest::save)
+    {
+        mMachine->saveState(mStateBuffer);
+
+        std::ofstream file(mStatePath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(mStateBuffer.data()), static_cast<std::streamsize>(mStateBuffer.size()));
+        return;
+    }
+
+    std::ifstream file(mStatePath, std::ios::binary);
+    if (!file) return;
+
+    mStateBuffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    // a state of another ROM or version is ignored; the game simply continues
+    mMachine->loadState(mStateBuffer.data(), mStateBuffer.size());
+}
+
+void Application::publishFrame()
+{
+    DisplayFrame& frame = mFrameBuffers.backBuffer();
+    frame.frameNumber = ++mFrameNumber;
+
+    if (mMachine->ppu().lastFrameStatistics().frameChanged) mContentVersion++;
+    frame.contentVersion = mContentVersion;
+
+    if (mFrameStreamer) mFrameStreamer->submit(frame);
+
+    // hands the frame over by swapping buffer indices; the PPU continues in the buffer handed back
+    mFrameBuffers.publish();
+    mMachine->ppu().setDisplayBuffer(mFrameBuffers.backBuffer().displayData, mFrameBuffers.backIndex());
+}
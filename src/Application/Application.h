@@ -1,27 +1,179 @@
 #pragma once
 
+#include "ApplicationDefines.h"
+#include "FramePacer.h"
+#include "../Audio/Resampler.h"
+#include "../Audio/RingBuffer.h"
+#include "../Display/ColorTable.h"
+#include "../Display/FrameScaler.h"
+#include "../Display/FrameStreamer.h"
+#include "../Display/TripleBuffer.h"
+#include "../Hardware/Machine/InputMovie.h"
+#include "../Hardware/Machine/Machine.h"
+#include "../Hardware/SaveState/RewindBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+
+class AudioManager;
+class DisplayManager;
 
-class CpuCore;
+/*  the emulation runs on mGameLoopThread one frame at a time and publishes every drawn frame through a triple buffer.
+    loop() is called from the main (SDL) thread and presents the newest published frame. Input travels the other
+    way through a lock-free queue; the emulation thread never calls into SDL.
+    Save states (F5 saves, F8 loads) go to a file next to the ROM; holding R plays the rewind history backwards.
+    F1 resets the machine.
+    The emulation paces itself through mFramePacer, so presentation never holds it back. While paused, both
+    threads block until something happens.
+*/
 
 class Application
 {
 public:
-    Application();
+    // a headless application opens no window; frames only go to the frame stream, if any
+    explicit Application(const bool headless = false);
     ~Application();
 
     void loop();
 
-    void processInput();
+    // waits up to timeout for the first event
+    void processInput(const std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+    void handleKey(const int32_t key, const bool pressed);
+    // starts the emulation from a reset
     void loadRom(const std::string& fileName);
-    
+
+    // runs the boot ROM on every reset instead of skipping it. Has to be called before loadRom; returns false if
+    // the file cannot be read or is no DMG or GBC boot ROM
+    bool setBootRom(const std::string& fileName);
+
+    // the machine resets before its next frame; ignored while a movie records or plays
     void resetSystem();
+
+    // has to be called before loadRom
+    void setColorCorrection(const bool enabled);
+
+    // upscales the frames on the CPU before presenting them; scale 1 leaves the scaling to the renderer
+    void setScaling(const FrameScaler::Filter filter, const uint8_t scale);
+
+    // has to be called before loadRom. Every frame is streamed; frame skipping is disabled meanwhile
+    bool openFrameStream(const std::string& fileName, const FrameStreamer::Format format, const bool skipDuplicates);
+
+    // stops the emulation after the given amount of frames (0 = no limit). Has to be called before loadRom
+    void setFrameLimit(const uint64_t frameCount);
+
+    // can be changed at any time. Holding tab switches to unlimited speed as well
+    void setSpeed(const FramePacer::SpeedMode mode, const uint8_t multiplier = 1);
+
+    /*  run-ahead hides the input lag of the game itself. After every frame the machine state is saved, the given
+        amount of frames gets emulated with the current input and only the last of them is shown; then the
+        state is restored. The sound always comes from the real frame. 0 disables it; has to be called before loadRom
+    */
+    void setRunAhead(const uint8_t frames);
+
+    // records every frame's input from the start of the emulation and writes the movie when it stops.
+    // Has to be called before loadRom
+    void recordMovie(const std::string& fileName);
+
+    // replays a movie from the given frame on, then continues with live input. Has to be called before loadRom
+    bool playMovie(const std::string& fileName, const uint64_t startFrame = 0);
+
+    // memory for the rewind history (0 disables it). Has to be called before loadRom
+    void setRewindCapacity(const size_t bytes);
+
+    // P toggles the pause as well
+    void setPaused(const bool paused);
+    bool isPaused() const;
+
+    bool isRunning() const;
+
 protected:
-    std::unique_ptr<CpuCore> mCpuCore;
+    void startEmulation();
+    void stopEmulation();
+
+    void emulationLoop();
+    void collectInput();
+    void waitWhilePaused();
+    void frameCompleted();
+    void outputAudio();
+    void runAhead();
+    void rewindFrame();
+    void playMovieFrame();
+    void handleStateRequest();
+    void publishFrame();
+
+    std::unique_ptr<Machine> mMachine;
+    std::unique_ptr<DisplayManager> mDisplayManager;
+    std::unique_ptr<AudioManager> mAudioManager;
+    std::unique_ptr<FrameStreamer> mFrameStreamer;
+
+    ColorTable::PixelFormat mPixelFormat { ColorTable::PixelFormat::argb8888 };
+
+    FramePacer mFramePacer;
+    FramePacer::SpeedMode mSelectedSpeedMode { FramePacer::SpeedMode::normal };
+    uint8_t mSelectedMultiplier { 1 };
+
+    TripleBuffer<DisplayFrame> mFrameBuffers;
+    uint64_t mEmulatedFrames {}; // including skipped ones
+    uint64_t mFrameNumber {};
+    uint64_t mContentVersion {};
+    uint64_t mFrameLimit {};
+
+    Resampler mResampler;
+    std::vector<int16_t> mAudioSamples; // APU output at its own rate
+    std::vector<int16_t> mResampledSamples; // at the rate of the audio device
+
+    // UI thread
+    uint8_t mButtons {};
+    RingBuffer<InputEvent> mInputQueue { 64 };
+
+    // emulation thread; button changes of the current frame
+    std::vector<Machine::ButtonChange> mPendingInput;
+    std::chrono::steady_clock::time_point mFrameStartTime {};
+
+    uint8_t mRunAheadFrames {};
+    bool mDrawRunAhead { true };
+    std::vector<uint8_t> mFrameState; // the machine after the latest real frame
+
+    RewindBuffer mRewindBuffer;
+    std::vector<uint8_t> mRewindState;
+    std::atomic<bool> mRewindHeld {};
+    bool mRewinding {};
+
+    enum class MovieMode : uint8_t
+    {
+        none,
+        record,
+        play
+    };
+
+    // emulation thread once running
+    InputMovie mMovie;
+    MovieMode mMovieMode { MovieMode::none };
+    std::string mMoviePath;
+    uint64_t mMovieFrame {}; // next frame to play
+
+    enum class StateRequest : uint8_t
+    {
+        none,
+        save,
+        load,
+        reset
+    };
+
+    std::string mStatePath;
+    std::vector<uint8_t> mStateBuffer;
+    std::atomic<StateRequest> mStateRequest { StateRequest::none };
 
-    bool mTerminate {};
+    std::atomic<bool> mTerminate {};
+    std::atomic<bool> mPaused {};
+    std::mutex mPauseMutex;
+    std::condition_variable mPauseCondition;
     std::thread mGameLoopThread;
-};
\ No newline at end of file
+};
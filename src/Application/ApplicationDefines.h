@@ -1,6 +1,29 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 
 static constexpr uint8_t gDisplayWidth = 160;
-static constexpr uint8_t gDisplayHeight = 144;
\ No newline at end of file
+static constexpr uint8_t gDisplayHeight = 144;
+
+// T-cycles per second at (single) hardware speed
+static constexpr uint32_t gClockRate = 4194304;
+
+// one pixel in the host format selected through ColorTable::PixelFormat (RGB565 uses the lower 16 bits)
+using DisplayData = std::array<uint32_t, gDisplayWidth * gDisplayHeight>;
+
+// the complete button state after a change on the UI thread (see Joypad::Button), stamped with the host time
+struct InputEvent
+{
+    int64_t hostTime {}; // nanoseconds of std::chrono::steady_clock
+    uint8_t buttons {};
+};
+
+// a completed frame as handed from the emulation to the presentation thread
+struct DisplayFrame
+{
+    DisplayData displayData {};
+
+    uint64_t frameNumber {};
+    uint64_t contentVersion {}; // only changes if the picture differs from the previous frame
+};
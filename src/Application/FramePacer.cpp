@@ -0,0 +1,82 @@
+#include "FramePacer.h"
+
+#include "ApplicationDefines.h"
+#include "../Hardware/PPU/PpuDefines.h"
+
+#include <algorithm>
+#include <thread>
+
+const std::chrono::nanoseconds FramePacer::framePeriod { static_cast<uint64_t>(cyclesPerFrame) * 1000000000 / gClockRate };
+
+void FramePacer::setSpeed(const SpeedMode mode, const uint8_t multiplier)
+{
+    mMultiplier = std::max<uint8_t>(multiplier, 1);
+    mSpeedMode = mode;
+}
+
+FramePacer::SpeedMode FramePacer::speedMode() const
+{
+    return mSpeedMode;
+}
+
+bool FramePacer::frameCompleted()
+{
+    const SpeedMode mode = mSpeedMode;
+    Clock::time_point now = Clock::now();
+
+    if (mStarted == false)
+    {
+        mStarted = true;
+        mNextFrameTime = now;
+        mLastDrawnFrameTime = now;
+    }
+
+    if (mode != SpeedMode::unlimited)
+    {
+        const uint8_t multiplier = mode == SpeedMode::multiplied ? mMultiplier.load() : 1;
+        const std::chrono::nanoseconds period = framePeriod / multiplier;
+
+        mNextFrameTime += period;
+        if (now < mNextFrameTime)
+        {
+            std::this_thread::sleep_until(mNextFrameTime);
+            now = Clock::now();
+        }
+        else if (now - mNextFrameTime > period * maxFramesBehind)
+        {
+            mNextFrameTime = now;
+        }
+    }
+
+    mFramesSinceDrawn++;
+
+    // at normal speed every frame is shown. Faster modes draw about as many frames as the display can show
+    bool draw = true;
+    if (mode == SpeedMode::multiplied)
+    {
+        draw = mFramesSinceDrawn >= mMultiplier;
+    }
+    else if (mode == SpeedMode::unlimited)
+    {
+        draw = presentationDue(now);
+    }
+
+    if (draw)
+    {
+        mFramesSinceDrawn = 0;
+        mLastDrawnFrameTime = now;
+    }
+
+    return draw;
+}
+
+void FramePacer::reset()
+{
+    mFramesSinceDrawn = 0;
+    mStarted = false;
+}
+
+bool FramePacer::presentationDue(const Clock::time_point now) const
+{
+    return now - mLastDrawnFrameTime >= framePeriod;
+}
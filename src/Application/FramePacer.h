@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/*  @ingroup Application
+
+    keeps the emulation at the selected speed and decides which frames are worth drawing.
+    Pacing happens against the wall clock on the emulation thread, so neither presentation nor audio can
+    slow down the emulation. Frames that would never be shown are skipped; the PPU still runs their timing.
+*/
+
+class FramePacer
+{
+public:
+    enum class SpeedMode : uint8_t
+    {
+        normal,     // real hardware speed
+        multiplied, // a whole multiple of the hardware speed
+        unlimited   // as fast as the host allows
+    };
+
+    FramePacer() = default;
+    ~FramePacer() = default;
+
+    // can be called from any thread; takes effect with the next frame
+    void setSpeed(const SpeedMode mode, const uint8_t multiplier = 1);
+    SpeedMode speedMode() const;
+
+    // called by the emulation thread after every emulated frame. Waits until the next frame is due and
+    // returns whether that frame should be drawn
+    bool frameCompleted();
+
+    void reset();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static const std::chrono::nanoseconds framePeriod;
+
+    // falling further behind than this (e.g. after the host stalled) restarts the pacing instead of catching up
+    static constexpr uint8_t maxFramesBehind = 4;
+
+    // presentation does not show more frames than the hardware would produce at normal speed
+    bool presentationDue(const Clock::time_point now) const;
+
+    std::atomic<SpeedMode> mSpeedMode { SpeedMode::normal };
+    std::atomic<uint8_t> mMultiplier { 1 };
+
+    Clock::time_point mNextFrameTime {};
+    Clock::time_point mLastDrawnFrameTime {};
+    uint32_t mFramesSinceDrawn {};
+
+    bool mStarted {};
+};
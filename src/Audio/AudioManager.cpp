@@ -0,0 +1,105 @@
+#include "AudioManager.h"
+
+#include <algorithm>
+
+// one second of stereo samples at the highest common rate
+static constexpr size_t gRingBufferCapacity = 2 * 96000;
+
+static constexpr uint16_t gDeviceBufferFrames = 512;
+
+AudioManager::AudioManager()
+    : mSamples(gRingBufferCapacity)
+{}
+
+AudioManager::~AudioManager()
+{
+    stop();
+}
+
+bool AudioManager::start(const uint32_t sampleRate)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) return false;
+
+    SDL_AudioSpec desired {};
+    desired.freq = static_cast<int>(sampleRate);
+    desired.format = AUDIO_S16SYS;
+    desired.channels = 2;
+    desired.samples = gDeviceBufferFrames;
+    desired.callback = &AudioManager::audioCallback;
+    desired.userdata = this;
+
+    SDL_AudioSpec obtained {};
+    mDevice = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0);
+    if (mDevice == 0)
+    {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    mSampleRate = static_cast<uint32_t>(obtained.freq);
+    mTargetFill = mSampleRate * targetLatencyMs / 1000;
+    mSmoothedFill = static_cast<double>(mTargetFill);
+
+    SDL_PauseAudioDevice(mDevice, 0);
+    return true;
+}
+
+void AudioManager::stop()
+{
+    if (mDevice == 0) return;
+
+    SDL_CloseAudioDevice(mDevice);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    mDevice = 0;
+}
+
+void AudioManager::queueSamples(const int16_t* samples, const uint32_t count)
+{
+    if (mDevice == 0) return;
+
+    // whatever does not fit is lost; the emulation must not wait for the device
+    const size_t pushed = mSamples.push(samples, count * 2) / 2;
+    if (pushed < count) mDroppedSamples += count - pushed;
+
+    // more samples per emulated second while the buffer is below its target, fewer while above
+    const double fill = static_cast<double>(mSamples.size() / 2);
+    mSmoothedFill += (fill - mSmoothedFill) * fillSmoothing;
+
+    const double deviation = std::clamp((static_cast<double>(mTargetFill) - mSmoothedFill) / mTargetFill, -1.0, 1.0);
+    mRateAdjustment = 1.0 + maxRateDeviation * deviation;
+    mReportedRateAdjustment = mRateAdjustment;
+}
+
+AudioManager::Statistics AudioManager::statistics() const
+{
+    Statistics statistics {};
+    statistics.fillLevel = mSamples.size() / 2;
+    statistics.underruns = mUnderruns;
+    statistics.droppedSamples = mDroppedSamples;
+    statistics.rateAdjustment = mReportedRateAdjustment;
+    return statistics;
+}
+
+void AudioManager::audioCallback(void* userData, Uint8* stream, int length)
+{
+    static_cast<AudioManager*>(userData)->fillStream(reinterpret_cast<int16_t*>(stream), static_cast<uint32_t>(length) / (2 * sizeof(int16_t)));
+}
+
+void AudioManager::fillStream(int16_t* samples, const uint32_t count)
+{
+    const size_t popped = mSamples.pop(samples, count * 2) / 2;
+    if (popped > 0)
+    {
+        mLastSample = { samples[popped * 2 - 2], samples[popped * 2 - 1] };
+    }
+
+    if (popped < count)
+    {
+        mUnderruns++;
+        for (size_t index = popped; index < count; index++)
+        {
+            samples[index * 2] = mLastSample[0];
+            samples[index * 2 + 1] = mLastSample[1];
+        }
+    }
+}
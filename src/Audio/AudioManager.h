@@ -0,0 +1,74 @@
+#pragma once
+
+#include "RingBuffer.h"
+
+#include "SDL.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*  @ingroup Audio
+
+    plays the APU output through an SDL audio device.
+    The emulation thread queues samples into a lock-free ring buffer that the SDL audio callback drains, so the
+    callback never waits for a lock. Dynamic rate control steers the fill level towards a fixed latency by
+    slightly changing the resampling ratio (at most by maxRateDeviation).
+*/
+
+class AudioManager
+{
+public:
+    AudioManager();
+    ~AudioManager();
+
+    static constexpr uint32_t defaultSampleRate = 48000;
+
+    struct Statistics
+    {
+        size_t fillLevel {}; // sample pairs waiting to be played
+        uint64_t underruns {}; // callbacks that ran out of samples
+        uint64_t droppedSamples {}; // sample pairs that did not fit into the ring buffer
+        double rateAdjustment { 1.0 };
+    };
+
+    // returns false if no audio device is available
+    bool start(const uint32_t sampleRate);
+    void stop();
+
+    // the rate the device actually runs at
+    uint32_t sampleRate() const { return mSampleRate; }
+
+    // emulation thread. Takes interleaved stereo samples; count is given in sample pairs. Never blocks
+    void queueSamples(const int16_t* samples, const uint32_t count);
+
+    // emulation thread. Factor for the resampling ratio, updated by every queueSamples call
+    double rateAdjustment() const { return mRateAdjustment; }
+
+    Statistics statistics() const;
+
+private:
+    static constexpr uint16_t targetLatencyMs = 50;
+    static constexpr double maxRateDeviation = 0.005;
+    static constexpr double fillSmoothing = 0.1;
+
+    static void audioCallback(void* userData, Uint8* stream, int length);
+    void fillStream(int16_t* samples, const uint32_t count);
+
+    SDL_AudioDeviceID mDevice {};
+    uint32_t mSampleRate {};
+    size_t mTargetFill {};
+
+    RingBuffer<int16_t> mSamples;
+
+    // emulation thread only
+    double mSmoothedFill {};
+    double mRateAdjustment { 1.0 };
+    std::atomic<double> mReportedRateAdjustment { 1.0 };
+
+    // callback only; repeated when the ring buffer runs dry to avoid clicks
+    std::array<int16_t, 2> mLastSample {};
+
+    std::atomic<uint64_t> mUnderruns {};
+    std::atomic<uint64_t> mDroppedSamples {};
+};
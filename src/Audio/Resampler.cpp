@@ -0,0 +1,154 @@
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+Resampler::Resampler()
+{
+    configure(48000, 48000, Quality::balanced);
+}
+
+void Resampler::configure(const uint32_t inputRate, const uint32_t outputRate, const Quality quality)
+{
+    switch (quality)
+    {
+        case Quality::fast: mTaps = 8; mPhaseCount = 64; break;
+        case Quality::balanced: mTaps = 16; mPhaseCount = 128; break;
+        case Quality::best: mTaps = 32; mPhaseCount = 256; break;
+    }
+
+    mNominalStep = static_cast<double>(inputRate) / outputRate;
+    mStep = mNominalStep;
+
+    // when reducing the rate the passband has to end below the output's Nyquist frequency
+    const double transitionWidth = 4.0 / mTaps;
+    buildKernels(std::min(1.0, 1.0 / mNominalStep) * (1.0 - transitionWidth * 0.5));
+
+    reset();
+}
+
+void Resampler::setRatioAdjustment(const double factor)
+{
+    mStep = mNominalStep / factor;
+}
+
+size_t Resampler::process(const int16_t* input, const size_t count, std::vector<int16_t>& output)
+{
+    static constexpr float scale = 1.0f / 32768.0f;
+
+    const size_t previousSize = mLeft.size();
+    mLeft.resize(previousSize + count);
+    mRight.resize(previousSize + count);
+    for (size_t index = 0; index < count; index++)
+    {
+        mLeft[previousSize + index] = input[index * 2] * scale;
+        mRight[previousSize + index] = input[index * 2 + 1] * scale;
+    }
+
+    const size_t outputStart = output.size();
+    const size_t available = mLeft.size();
+
+    while (static_cast<size_t>(mPosition) + mTaps <= available)
+    {
+        const size_t base = static_cast<size_t>(mPosition);
+        const uint16_t phase = static_cast<uint16_t>((mPosition - base) * mPhaseCount);
+        const float* kernel = &mKernels[phase * mTaps];
+
+        const float left = convolve(kernel, &mLeft[base]);
+        const float right = convolve(kernel, &mRight[base]);
+
+        output.push_back(static_cast<int16_t>(std::clamp(std::lround(left * 32768.0f), -32768L, 32767L)));
+        output.push_back(static_cast<int16_t>(std::clamp(std::lround(right * 32768.0f), -32768L, 32767L)));
+
+        mPosition += mStep;
+    }
+
+    // drop what no further output sample needs
+    const size_t consumed = std::min(static_cast<size_t>(mPosition), available);
+    mLeft.erase(mLeft.begin(), mLeft.begin() + consumed);
+    mRight.erase(mRight.begin(), mRight.begin() + consumed);
+    mPosition -= consumed;
+
+    return (output.size() - outputStart) / 2;
+}
+
+void Resampler::reset()
+{
+    // starts with silence as history
+    mLeft.assign(mTaps - 1, 0.0f);
+    mRight.assign(mTaps - 1, 0.0f);
+    mPosition = 0.0;
+}
+
+void Resampler::buildKernels(const double cutoff)
+{
+    static constexpr double pi = 3.14159265358979323846;
+
+    mKernels.assign(static_cast<size_t>(mPhaseCount) * mTaps, 0.0f);
+
+    const double center = mTaps / 2 - 1;
+    for (uint16_t phase = 0; phase < mPhaseCount; phase++)
+    {
+        float* kernel = &mKernels[phase * mTaps];
+        double sum = 0.0;
+
+        for (uint8_t tap = 0; tap < mTaps; tap++)
+        {
+            // distance to the output position, in input samples
+            const double x = tap - center - static_cast<double>(phase) / mPhaseCount;
+            const double sinc = x == 0.0 ? cutoff : std::sin(pi * cutoff * x) / (pi * x);
+
+            // Blackman-Harris window over the whole kernel
+            const double windowPosition = (x + center + 1.0) / mTaps;
+            const double window = 0.35875 - 0.48829 * std::cos(2.0 * pi * windowPosition) + 0.14128 * std::cos(4.0 * pi * windowPosition) - 0.01168 * std::cos(6.0 * pi * windowPosition);
+
+            const double value = sinc * std::max(window, 0.0);
+            kernel[tap] = static_cast<float>(value);
+            sum += value;
+        }
+
+        // unity gain at DC for every phase
+        for (uint8_t tap = 0; tap < mTaps; tap++)
+        {
+            kernel[tap] = static_cast<float>(kernel[tap] / sum);
+        }
+    }
+}
+
+float Resampler::convolve(const float* kernel, const float* samples) const
+{
+    // the tap counts are multiples of 8
+#if defined(__AVX2__)
+    __m256 sum = _mm256_setzero_ps();
+    for (uint8_t tap = 0; tap < mTaps; tap += 8)
+    {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(kernel + tap), _mm256_loadu_ps(samples + tap)));
+    }
+
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    const __m128 quarter = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_add_ss(quarter, _mm_shuffle_ps(quarter, quarter, 0b01)));
+#elif defined(__SSE2__)
+    __m128 sum = _mm_setzero_ps();
+    for (uint8_t tap = 0; tap < mTaps; tap += 4)
+    {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(kernel + tap), _mm_loadu_ps(samples + tap)));
+    }
+
+    const __m128 half = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 0b01)));
+#else
+    float sum = 0.0f;
+    for (uint8_t tap = 0; tap < mTaps; tap++)
+    {
+        sum += kernel[tap] * samples[tap];
+    }
+    return sum;
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*  @ingroup Audio
+
+    polyphase windowed sinc resampler from the APU's sample rate to the rate of the audio device.
+    Works on whole blocks of interleaved stereo samples. The filter bank holds one kernel per phase, so every
+    output sample is a single dot product per side; these use AVX2 or SSE2 where available.
+    The ratio can be adjusted while running, which the dynamic rate control of the audio output relies on.
+*/
+
+class Resampler
+{
+public:
+    enum class Quality : uint8_t
+    {
+        fast = 0, // 8 taps, 64 phases
+        balanced = 1, // 16 taps, 128 phases
+        best = 2 // 32 taps, 256 phases
+    };
+
+    Resampler();
+    ~Resampler() = default;
+
+    // drops any buffered input
+    void configure(const uint32_t inputRate, const uint32_t outputRate, const Quality quality);
+
+    // factors above 1 produce more output samples per input sample
+    void setRatioAdjustment(const double factor);
+
+    // appends the resampled block to output. count is given in sample pairs; returns the amount of pairs appended
+    size_t process(const int16_t* input, const size_t count, std::vector<int16_t>& output);
+
+    void reset();
+
+private:
+    void buildKernels(const double cutoff);
+
+    // sum of kernel[i] * samples[i] over mTaps values
+    float convolve(const float* kernel, const float* samples) const;
+
+    uint8_t mTaps {};
+    uint16_t mPhaseCount {};
+    std::vector<float> mKernels; // [phase][tap]
+
+    // input not consumed yet, one array per side; the first mTaps - 1 values are history
+    std::vector<float> mLeft;
+    std::vector<float> mRight;
+
+    double mNominalStep { 1.0 }; // input samples per output sample
+    double mStep { 1.0 };
+    double mPosition {}; // of the next output sample within mLeft/mRight
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*  @ingroup Audio
+
+    lock-free queue between exactly one producer and one consumer thread.
+    Both sides only ever advance their own position, so neither has to wait for the other. A full queue refuses
+    new elements and an empty one delivers none; what to do then is up to the caller.
+*/
+
+template <typename T>
+class RingBuffer
+{
+public:
+    // the capacity is rounded up to a power of two
+    explicit RingBuffer(const size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+
+        mElements.resize(size);
+        mMask = size - 1;
+    }
+    ~RingBuffer() = default;
+
+    size_t capacity() const { return mElements.size(); }
+
+    // may be called from either side; only a snapshot while the other side is active
+    size_t size() const
+    {
+        return mWritePosition.load(std::memory_order_acquire) - mReadPosition.load(std::memory_order_acquire);
+    }
+
+    // producer side. Returns the amount of elements that fitted
+    size_t push(const T* elements, const size_t count)
+    {
+        const size_t writePosition = mWritePosition.load(std::memory_order_relaxed);
+        const size_t readPosition = mReadPosition.load(std::memory_order_acquire);
+        const size_t pushCount = std::min(count, capacity() - (writePosition - readPosition));
+
+        for (size_t index = 0; index < pushCount; index++)
+        {
+            mElements[(writePosition + index) & mMask] = elements[index];
+        }
+
+        mWritePosition.store(writePosition + pushCount, std::memory_order_release);
+        return pushCount;
+    }
+
+    bool push(const T& element) { return push(&element, 1) == 1; }
+
+    // consumer side. Returns the amount of elements that were available
+    size_t pop(T* elements, const size_t count)
+    {
+        const size_t readPosition = mReadPosition.load(std::memory_order_relaxed);
+        const size_t writePosition = mWritePosition.load(std::memory_order_acquire);
+        const size_t popCount = std::min(count, writePosition - readPosition);
+
+        for (size_t index = 0; index < popCount; index++)
+        {
+            elements[index] = mElements[(readPosition + index) & mMask];
+        }
+
+        mReadPosition.store(readPosition + popCount, std::memory_order_release);
+        return popCount;
+    }
+
+    bool pop(T& element) { return pop(&element, 1) == 1; }
+
+private:
+    std::vector<T> mElements;
+    size_t mMask {};
+
+    // producer and consumer positions live on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> mWritePosition {};
+    alignas(64) std::atomic<size_t> mReadPosition {};
+};
@@ -0,0 +1,55 @@
+#include "ColorTable.h"
+
+#include <algorithm>
+
+const ColorTable& ColorTable::instance()
+{
+    static const ColorTable colorTable;
+    return colorTable;
+}
+
+const ColorTable::Table& ColorTable::table(const PixelFormat format, const ColorCorrection correction) const
+{
+    return mTables[static_cast<uint8_t>(format) * 2 + static_cast<uint8_t>(correction)];
+}
+
+ColorTable::ColorTable()
+{
+    for (const PixelFormat format : { PixelFormat::argb8888, PixelFormat::rgb565 })
+    {
+        for (const ColorCorrection correction : { ColorCorrection::none, ColorCorrection::lcd })
+        {
+            Table& table = mTables[static_cast<uint8_t>(format) * 2 + static_cast<uint8_t>(correction)];
+            for (uint16_t color = 0; color < colorCount; color++)
+            {
+                table[color] = convert(color, format, correction);
+            }
+        }
+    }
+}
+
+uint32_t ColorTable::convert(const uint16_t color, const PixelFormat format, const ColorCorrection correction)
+{
+    const uint8_t red = color & 0x1F;
+    const uint8_t green = (color >> 5) & 0x1F;
+    const uint8_t blue = (color >> 10) & 0x1F;
+
+    uint8_t finalRed = (red << 3) | (red >> 2);
+    uint8_t finalGreen = (green << 3) | (green >> 2);
+    uint8_t finalBlue = (blue << 3) | (blue >> 2);
+
+    if (correction == ColorCorrection::lcd)
+    {
+        // channels bleed into each other on the GBC screen, and it never gets fully bright
+        finalRed = static_cast<uint8_t>(std::min(960, red * 26 + green * 4 + blue * 2) >> 2);
+        finalGreen = static_cast<uint8_t>(std::min(960, green * 24 + blue * 8) >> 2);
+        finalBlue = static_cast<uint8_t>(std::min(960, red * 6 + green * 4 + blue * 22) >> 2);
+    }
+
+    if (format == PixelFormat::rgb565)
+    {
+        return ((finalRed >> 3) << 11) | ((finalGreen >> 2) << 5) | (finalBlue >> 3);
+    }
+
+    return 0xFF000000 | (finalRed << 16) | (finalGreen << 8) | finalBlue;
+}
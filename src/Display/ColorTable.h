@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*  @ingroup Display
+
+    lookup tables from the 15-bit BGR555 colours of the GBC to the host pixel formats.
+    All tables are built once, on first use, and shared by every emulated machine.
+*/
+
+class ColorTable
+{
+public:
+    enum class PixelFormat : uint8_t
+    {
+        argb8888 = 0,
+        rgb565 = 1
+    };
+
+    enum class ColorCorrection : uint8_t
+    {
+        none = 0, // plain 5 to 8 bit expansion
+        lcd = 1 // approximates the washed out colours of the GBC screen
+    };
+
+    static constexpr uint16_t colorCount = 0x8000;
+    using Table = std::array<uint32_t, colorCount>;
+
+    static const ColorTable& instance();
+
+    const Table& table(const PixelFormat format, const ColorCorrection correction) const;
+
+private:
+    ColorTable();
+    ~ColorTable() = default;
+
+    static uint32_t convert(const uint16_t color, const PixelFormat format, const ColorCorrection correction);
+
+    std::array<Table, 4> mTables {}; // [format][correction]
+};
@@ -3,30 +3,99 @@
 #include "SDL.h"
 #include "SDL_video.h"
 
+#include <algorithm>
+
+#include <thread>
+
+static constexpr uint8_t gWindowScale = 4;
+static constexpr uint8_t gMaxScalerThreads = 8;
+
 DisplayManager::DisplayManager()
+    : mFrameScaler(static_cast<uint8_t>(std::clamp(std::thread::hardware_concurrency(), 1u, static_cast<unsigned>(gMaxScalerThreads))))
 {}
 
 DisplayManager::~DisplayManager()
 {
+    stop();
     SDL_Quit();
 }
 
-void DisplayManager::start()
+void DisplayManager::start(const ColorTable::PixelFormat pixelFormat)
 {
+    mPixelFormat = pixelFormat;
+
+    SDL_Init(SDL_INIT_VIDEO);
 
+    mWindow.reset(SDL_CreateWindow("BoyColorGame", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, gDisplayWidth * gWindowScale, gDisplayHeight * gWindowScale, SDL_WINDOW_RESIZABLE));
+    if (!mWindow) return;
+
+    mRenderer.reset(SDL_CreateRenderer(mWindow.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+    if (!mRenderer) return;
+
+    createTexture();
 }
 
 void DisplayManager::stop()
 {
+    mTexture.reset();
+    mRenderer.reset();
+    mWindow.reset();
 
+    mTextureValid = false;
 }
 
-void DisplayManager::renderImage()
+void DisplayManager::renderImage(const DisplayFrame& frame)
 {
+    if (!mTexture) return;
 
+    if (frame.contentVersion != mUploadedContentVersion || mTextureValid == false)
+    {
+        // the PPU already wrote host colours; RGB565 frames only have to be narrowed
+        const DisplayData& displayData = frame.displayData;
+        if (mFrameScaler.scale() > 1)
+        {
+            void* pixels = nullptr;
+            int pitch = 0;
+            if (SDL_LockTexture(mTexture.get(), nullptr, &pixels, &pitch) == 0)
+            {
+                mFrameScaler.scaleFrame(displayData, static_cast<uint32_t*>(pixels), pitch);
+                SDL_UnlockTexture(mTexture.get());
+            }
+        }
+        else if (mPixelFormat == ColorTable::PixelFormat::rgb565)
+        {
+            std::copy(displayData.cbegin(), displayData.cend(), mTextureData.begin());
+            SDL_UpdateTexture(mTexture.get(), nullptr, mTextureData.data(), gDisplayWidth * sizeof(uint16_t));
+        }
+        else
+        {
+            SDL_UpdateTexture(mTexture.get(), nullptr, displayData.data(), gDisplayWidth * sizeof(uint32_t));
+        }
+        mUploadedContentVersion = frame.contentVersion;
+        mTextureValid = true;
+    }
+
+    SDL_RenderClear(mRenderer.get());
+    SDL_RenderCopy(mRenderer.get(), mTexture.get(), nullptr, nullptr);
+    SDL_RenderPresent(mRenderer.get());
+}
+
+void DisplayManager::setScaling(const FrameScaler::Filter filter, const uint8_t scale)
+{
+    if (mPixelFormat != ColorTable::PixelFormat::argb8888) return;
+
+    mFrameScaler.setFilter(filter, scale);
+    if (mRenderer) createTexture();
+}
+
+void DisplayManager::createTexture()
+{
+    const uint32_t textureFormat = (mPixelFormat == ColorTable::PixelFormat::rgb565) ? SDL_PIXELFORMAT_RGB565 : SDL_PIXELFORMAT_ARGB8888;
+    mTexture.reset(SDL_CreateTexture(mRenderer.get(), textureFormat, SDL_TEXTUREACCESS_STREAMING, mFrameScaler.outputWidth(), mFrameScaler.outputHeight()));
+    mTextureValid = false;
 }
 
 void DisplayManager::reset()
 {
-    
-}
\ No newline at end of file
+    mTextureValid = false;
+}
@@ -3,6 +3,8 @@
 #define SDL_MAIN_HANDLED
 #pragma once
 
+#include "ColorTable.h"
+#include "FrameScaler.h"
 #include "SDL.h"
 
 #include <array>
@@ -14,14 +16,20 @@ public:
     DisplayManager();
     ~DisplayManager();
 
-    void start();
+    void start(const ColorTable::PixelFormat pixelFormat);
     void stop();
 
-    void renderImage();
+    // presents the given frame. The texture upload is skipped if its content did not change since the last upload
+    void renderImage(const DisplayFrame& frame);
+
+    // frames are scaled on the CPU before the upload; only available for ARGB8888
+    void setScaling(const FrameScaler::Filter filter, const uint8_t scale);
 
     void reset();
 
 private:
+    void createTexture();
+
     struct SdlWindowDtor
     {
         void operator() (SDL_Window* window) const { SDL_DestroyWindow(window); }
@@ -32,8 +40,21 @@ private:
         void operator() (SDL_Renderer* renderer) const { SDL_DestroyRenderer(renderer); }
     };
 
+    struct SdlTextureDtor
+    {
+        void operator() (SDL_Texture* texture) const { SDL_DestroyTexture(texture); }
+    };
+
     std::unique_ptr<SDL_Renderer, SdlRendererDtor> mRenderer;
     std::unique_ptr<SDL_Window, SdlWindowDtor> mWindow;
+    std::unique_ptr<SDL_Texture, SdlTextureDtor> mTexture;
+
+    // staging area for RGB565 frames; ARGB8888 frames are uploaded as they are
+    std::array<uint16_t, gDisplayWidth * gDisplayHeight> mTextureData;
+    ColorTable::PixelFormat mPixelFormat { ColorTable::PixelFormat::argb8888 };
+
+    FrameScaler mFrameScaler;
 
-    std::array<uint8_t, gDisplayWidth * gDisplayHeight> mDisplayData;
-};
\ No newline at end of file
+    uint64_t mUploadedContentVersion {};
+    bool mTextureValid {};
+};
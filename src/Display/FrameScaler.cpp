@@ -0,0 +1,276 @@
+#include "FrameScaler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+FrameScaler::FrameScaler(const uint8_t threadCount)
+    : mBandCount(std::max<uint8_t>(1, threadCount))
+{
+    // the calling thread scales the first band itself
+    for (uint8_t bandId = 1; bandId < mBandCount; bandId++)
+    {
+        mWorkers.emplace_back(&FrameScaler::workerLoop, this, bandId);
+    }
+
+    setFilter(Filter::nearest, 1);
+}
+
+FrameScaler::~FrameScaler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopWorkers = true;
+    }
+    mStartCondition.notify_all();
+
+    for (std::thread& worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+void FrameScaler::setFilter(const Filter filter, const uint8_t scale)
+{
+    mFilter = filter;
+    mScale = std::max<uint8_t>(1, scale);
+
+    // a corner triangle covers the sub pixels up to half the scaled pixel away from its corner, with an anti-aliased edge
+    for (uint8_t corner = 0; corner < mCornerWeights.size(); corner++)
+    {
+        std::vector<uint8_t>& weights = mCornerWeights[corner];
+        weights.assign(mScale * mScale, 0);
+
+        for (uint8_t y = 0; y < mScale; y++)
+        {
+            for (uint8_t x = 0; x < mScale; x++)
+            {
+                const float cornerX = (corner & 0b01) ? (mScale - x - 0.5f) : (x + 0.5f);
+                const float cornerY = (corner & 0b10) ? (mScale - y - 0.5f) : (y + 0.5f);
+                const float coverage = std::clamp(mScale * 0.5f + 1.0f - (cornerX + cornerY), 0.0f, 1.0f);
+
+                weights[y * mScale + x] = static_cast<uint8_t>(coverage * 128.0f);
+            }
+        }
+    }
+}
+
+void FrameScaler::scaleFrame(const DisplayData& source, uint32_t* destination, const size_t pitch)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSource = &source;
+        mDestination = destination;
+        mPitch = pitch;
+
+        mPendingBands = mBandCount - 1;
+        mJobGeneration++;
+    }
+    mStartCondition.notify_all();
+
+    scaleBand(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCondition.wait(lock, [this] { return mPendingBands == 0; });
+    }
+
+    mLastDuration = std::chrono::steady_clock::now() - start;
+}
+
+void FrameScaler::workerLoop(const uint8_t bandId)
+{
+    uint64_t handledGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStartCondition.wait(lock, [this, handledGeneration] { return mStopWorkers || mJobGeneration != handledGeneration; });
+
+            if (mStopWorkers) return;
+            handledGeneration = mJobGeneration;
+        }
+
+        scaleBand(bandId);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mPendingBands == 0) mDoneCondition.notify_one();
+        }
+    }
+}
+
+void FrameScaler::scaleBand(const uint8_t bandId)
+{
+    const uint8_t firstLine = bandId * gDisplayHeight / mBandCount;
+    const uint8_t lastLine = (bandId + 1) * gDisplayHeight / mBandCount;
+
+    for (uint8_t sourceLine = firstLine; sourceLine < lastLine; sourceLine++)
+    {
+        scaleLine(sourceLine);
+
+        if (mFilter == Filter::edge_aware) scaleLineEdgeAware(sourceLine);
+    }
+}
+
+void FrameScaler::scaleLine(const uint8_t sourceLine)
+{
+    const uint32_t* source = mSource->data() + sourceLine * gDisplayWidth;
+    uint32_t* firstLine = destinationLine(sourceLine * mScale);
+
+    // widen one line; every further line of the scaled pixel row is a plain copy of it
+    for (uint8_t x = 0; x < gDisplayWidth; x++)
+    {
+        fillPixelBlock(firstLine + x * mScale, source[x]);
+    }
+
+    const size_t lineBytes = outputWidth() * sizeof(uint32_t);
+    for (uint8_t y = 1; y < mScale; y++)
+    {
+        std::memcpy(destinationLine(sourceLine * mScale + y), firstLine, lineBytes);
+    }
+
+    if (mFilter == Filter::scanlines && mScale > 1)
+    {
+        const uint8_t darkLines = std::max(1, mScale / 3);
+        for (uint8_t y = mScale - darkLines; y < mScale; y++)
+        {
+            darkenRow(destinationLine(sourceLine * mScale + y));
+        }
+    }
+}
+
+void FrameScaler::scaleLineEdgeAware(const uint8_t sourceLine)
+{
+    const uint32_t* line = mSource->data() + sourceLine * gDisplayWidth;
+    const uint32_t* lineAbove = (sourceLine > 0) ? line - gDisplayWidth : line;
+    const uint32_t* lineBelow = (sourceLine + 1 < gDisplayHeight) ? line + gDisplayWidth : line;
+
+    for (uint8_t x = 0; x < gDisplayWidth; x++)
+    {
+        //  A B C
+        //  D E F
+        //  G H I
+        const uint32_t b = lineAbove[x];
+        const uint32_t d = line[x > 0 ? x - 1 : x];
+        const uint32_t e = line[x];
+        const uint32_t f = line[x + 1 < gDisplayWidth ? x + 1 : x];
+        const uint32_t h = lineBelow[x];
+
+        // a corner is cut if both of its neighbours share a colour that forms an edge through it
+        const std::array<bool, 4> cornerActive
+        {
+            d == b && b != f && d != h && b != e, // top left
+            b == f && b != d && f != h && b != e, // top right
+            d == h && d != b && h != f && d != e, // bottom left
+            h == f && d != h && b != f && h != e // bottom right
+        };
+        const std::array<uint32_t, 4> cornerColors { b, b, h, h };
+
+        // most pixels are not on an edge and keep their nearest neighbour block
+        if ((cornerActive[0] || cornerActive[1] || cornerActive[2] || cornerActive[3]) == false) continue;
+
+        for (uint8_t y = 0; y < mScale; y++)
+        {
+            uint32_t* target = destinationLine(sourceLine * mScale + y) + x * mScale;
+            for (uint8_t corner = 0; corner < 4; corner++)
+            {
+                if (cornerActive[corner]) blendRow(target, cornerColors[corner], &mCornerWeights[corner][y * mScale]);
+            }
+        }
+    }
+}
+
+uint32_t* FrameScaler::destinationLine(const uint16_t line) const
+{
+    return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(mDestination) + line * mPitch);
+}
+
+void FrameScaler::fillPixelBlock(uint32_t* target, const uint32_t color) const
+{
+    uint8_t x = 0;
+
+#if defined(__SSE2__)
+    const __m128i colors = _mm_set1_epi32(static_cast<int>(color));
+    for (; x + 4 <= mScale; x += 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), colors);
+    }
+#endif
+
+    for (; x < mScale; x++)
+    {
+        target[x] = color;
+    }
+}
+
+void FrameScaler::blendRow(uint32_t* target, const uint32_t color, const uint8_t* weights) const
+{
+    uint8_t x = 0;
+
+#if defined(__SSE2__)
+    // per channel: target + (color - target) * weight / 128, on two pixels per 16 bit vector
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colorChannels = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+
+    for (; x + 4 <= mScale; x += 4)
+    {
+        if ((weights[x] | weights[x + 1] | weights[x + 2] | weights[x + 3]) == 0) continue;
+
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + x));
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+
+        const __m128i lowWeights = _mm_set_epi16(weights[x + 1], weights[x + 1], weights[x + 1], weights[x + 1], weights[x], weights[x], weights[x], weights[x]);
+        const __m128i highWeights = _mm_set_epi16(weights[x + 3], weights[x + 3], weights[x + 3], weights[x + 3], weights[x + 2], weights[x + 2], weights[x + 2], weights[x + 2]);
+
+        low = _mm_add_epi16(low, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(colorChannels, low), lowWeights), 7));
+        high = _mm_add_epi16(high, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(colorChannels, high), highWeights), 7));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(low, high));
+    }
+#endif
+
+    for (; x < mScale; x++)
+    {
+        const uint8_t weight = weights[x];
+        if (weight == 0) continue;
+
+        uint32_t result = 0;
+        for (uint8_t shift = 0; shift < 32; shift += 8)
+        {
+            const int16_t targetChannel = (target[x] >> shift) & 0xFF;
+            const int16_t colorChannel = (color >> shift) & 0xFF;
+            result |= static_cast<uint32_t>(targetChannel + (((colorChannel - targetChannel) * weight) >> 7)) << shift;
+        }
+        target[x] = result;
+    }
+}
+
+void FrameScaler::darkenRow(uint32_t* target) const
+{
+    // 75 % brightness, alpha untouched
+    const uint16_t width = outputWidth();
+    uint16_t x = 0;
+
+#if defined(__SSE2__)
+    const __m128i channelMask = _mm_set1_epi32(0x003F3F3F);
+    for (; x + 4 <= width; x += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(target + x));
+        const __m128i quarter = _mm_and_si128(_mm_srli_epi32(pixels, 2), channelMask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_sub_epi32(pixels, quarter));
+    }
+#endif
+
+    for (; x < width; x++)
+    {
+        target[x] -= (target[x] >> 2) & 0x003F3F3F;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../Application/ApplicationDefines.h"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*  @ingroup Display
+
+    CPU side integer upscaling of ARGB8888 frames for large screens.
+    The source lines are split into bands which are scaled in parallel by a small pool of worker threads.
+    Inner loops use SSE2 where available.
+*/
+
+class FrameScaler
+{
+public:
+    enum class Filter : uint8_t
+    {
+        nearest = 0,
+        scanlines = 1, // nearest neighbour with darkened gaps between the source lines
+        edge_aware = 2 // smooths diagonal edges (EPX/xBR style corner rules)
+    };
+
+    FrameScaler(const uint8_t threadCount);
+    ~FrameScaler();
+
+    void setFilter(const Filter filter, const uint8_t scale);
+
+    Filter filter() const { return mFilter; }
+    uint8_t scale() const { return mScale; }
+
+    uint16_t outputWidth() const { return gDisplayWidth * mScale; }
+    uint16_t outputHeight() const { return gDisplayHeight * mScale; }
+
+    // scales the frame into destination, whose lines are pitch bytes apart
+    void scaleFrame(const DisplayData& source, uint32_t* destination, const size_t pitch);
+
+    // time the last scaleFrame call took
+    std::chrono::nanoseconds lastDuration() const { return mLastDuration; }
+
+private:
+    void workerLoop(const uint8_t bandId);
+    void scaleBand(const uint8_t bandId);
+
+    void scaleLine(const uint8_t sourceLine);
+    void scaleLineEdgeAware(const uint8_t sourceLine);
+
+    uint32_t* destinationLine(const uint16_t line) const;
+
+    void fillPixelBlock(uint32_t* target, const uint32_t color) const;
+    void blendRow(uint32_t* target, const uint32_t color, const uint8_t* weights) const;
+    void darkenRow(uint32_t* target) const;
+
+    Filter mFilter { Filter::nearest };
+    uint8_t mScale { 1 };
+
+    // coverage (0 - 128) of the four corner triangles per sub pixel of a scaled pixel; [corner][y * scale + x]
+    std::array<std::vector<uint8_t>, 4> mCornerWeights;
+
+    // current job
+    const DisplayData* mSource {};
+    uint32_t* mDestination {};
+    size_t mPitch {};
+
+    std::chrono::nanoseconds mLastDuration {};
+
+    uint8_t mBandCount {};
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mStartCondition;
+    std::condition_variable mDoneCondition;
+    uint64_t mJobGeneration {};
+    uint8_t mPendingBands {};
+    bool mStopWorkers {};
+};
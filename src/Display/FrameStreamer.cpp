@@ -0,0 +1,264 @@
+#include "FrameStreamer.h"
+
+#include "../Hardware/PPU/PpuDefines.h"
+
+#include <string>
+
+// the first line of a timestamp file of mkvmerge's format v2, which has one time in milliseconds per frame
+static constexpr char gTimestampHeader[] = "# timestamp format v2\n";
+
+// enough for a couple of frames of disk hiccups before the pool has to grow
+static constexpr uint8_t gInitialBufferCount = 8;
+
+static constexpr uint32_t gPixelCount = gDisplayWidth * gDisplayHeight;
+
+FrameStreamer::~FrameStreamer()
+{
+    close();
+}
+
+bool FrameStreamer::open(const std::string& fileName, const Format format, const ColorTable::PixelFormat pixelFormat, const bool skipDuplicates)
+{
+    close();
+
+    mOwnsFile = fileName != "-";
+    if (skipDuplicates && mOwnsFile == false) return false;
+
+    mFile = mOwnsFile ? std::fopen(fileName.c_str(), "wb") : stdout;
+    if (mFile == nullptr) return false;
+
+    if (skipDuplicates)
+    {
+        mTimestampFile = std::fopen((fileName + ".timestamps").c_str(), "w");
+        if (mTimestampFile == nullptr)
+        {
+            close();
+            return false;
+        }
+        std::fputs(gTimestampHeader, mTimestampFile);
+    }
+
+    mFormat = format;
+    mPixelFormat = pixelFormat;
+    mSkipDuplicates = skipDuplicates;
+    mFrameIndex = 0;
+
+    mFramesWritten = 0;
+    mDuplicatesSkipped = 0;
+    mStopWriter = false;
+
+    if (mFormat == Format::y4m)
+    {
+        // the frame rate is given exactly as clock rate per frame length
+        const std::string header = "YUV4MPEG2 W" + std::to_string(gDisplayWidth) + " H" + std::to_string(gDisplayHeight)
+                                 + " F" + std::to_string(gClockRate) + ":" + std::to_string(cyclesPerFrame) + " Ip A1:1 C444\n";
+        std::fwrite(header.data(), 1, header.size(), mFile);
+    }
+
+    while (mFreeBuffers.size() < gInitialBufferCount)
+    {
+        mFreeBuffers.push_back(std::make_unique<DisplayData>());
+    }
+
+    mWriter = std::thread(&FrameStreamer::writerLoop, this);
+    return true;
+}
+
+void FrameStreamer::close()
+{
+    if (mWriter.joinable())
+    {
+        // the writer drains the queue before it stops
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopWriter = true;
+        }
+        mCondition.notify_one();
+        mWriter.join();
+    }
+
+    if (mFile)
+    {
+        if (mOwnsFile)
+        {
+            std::fclose(mFile);
+        }
+        else
+        {
+            std::fflush(mFile);
+        }
+        mFile = nullptr;
+    }
+
+    if (mTimestampFile)
+    {
+        std::fclose(mTimestampFile);
+        mTimestampFile = nullptr;
+    }
+}
+
+void FrameStreamer::submit(const DisplayFrame& frame)
+{
+    if (mFile == nullptr) return;
+
+    PendingFrame pendingFrame {};
+    pendingFrame.frameIndex = mFrameIndex++;
+
+    const bool duplicate = mSkipDuplicates && pendingFrame.frameIndex > 0 && frame.contentVersion == mLastContentVersion;
+    mLastContentVersion = frame.contentVersion;
+
+    if (duplicate == false)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mFreeBuffers.empty() == false)
+            {
+                pendingFrame.displayData = std::move(mFreeBuffers.back());
+                mFreeBuffers.pop_back();
+            }
+        }
+
+        if (!pendingFrame.displayData) pendingFrame.displayData = std::make_unique<DisplayData>();
+        *pendingFrame.displayData = frame.displayData;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(pendingFrame));
+    }
+    mCondition.notify_one();
+}
+
+uint64_t FrameStreamer::framesWritten() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFramesWritten;
+}
+
+uint64_t FrameStreamer::duplicatesSkipped() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDuplicatesSkipped;
+}
+
+void FrameStreamer::writerLoop()
+{
+    // a run of duplicates at the end has no frame after it to tell how long the last frame lasts
+    bool endsInDuplicates = false;
+    uint64_t lastFrameIndex = 0;
+
+    while (true)
+    {
+        PendingFrame pendingFrame {};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStopWriter || mQueue.empty() == false; });
+
+            if (mQueue.empty()) break;
+
+            pendingFrame = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        if (pendingFrame.displayData) writeFrame(*pendingFrame.displayData, pendingFrame.frameIndex);
+        endsInDuplicates = !pendingFrame.displayData;
+        lastFrameIndex = pendingFrame.frameIndex;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (pendingFrame.displayData)
+        {
+            mFreeBuffers.push_back(std::move(pendingFrame.displayData));
+            mFramesWritten++;
+        }
+        else
+        {
+            mDuplicatesSkipped++;
+        }
+    }
+
+    // so the last frame written is repeated at the time of the last duplicate
+    if (endsInDuplicates) writeOutput(lastFrameIndex);
+}
+
+void FrameStreamer::writeFrame(const DisplayData& displayData, const uint64_t frameIndex)
+{
+    if (mFormat == Format::y4m)
+    {
+        convertToYuv(displayData);
+    }
+    else
+    {
+        convertToRgb(displayData);
+    }
+
+    writeOutput(frameIndex);
+}
+
+void FrameStreamer::writeOutput(const uint64_t frameIndex)
+{
+    if (mFormat == Format::y4m)
+    {
+        static constexpr char frameHeader[] = "FRAME\n";
+        std::fwrite(frameHeader, 1, sizeof(frameHeader) - 1, mFile);
+    }
+
+    std::fwrite(mOutput.data(), 1, mOutput.size(), mFile);
+
+    if (mTimestampFile)
+    {
+        // to the microsecond, far finer than any player shows frames
+        const double milliseconds = static_cast<double>(frameIndex) * cyclesPerFrame * 1000.0 / gClockRate;
+        std::fprintf(mTimestampFile, "%.3f\n", milliseconds);
+    }
+}
+
+void FrameStreamer::convertToRgb(const DisplayData& displayData)
+{
+    mOutput.resize(gPixelCount * 3);
+
+    uint8_t* output = mOutput.data();
+    for (const uint32_t pixel : displayData)
+    {
+        hostToRgb(pixel, output[0], output[1], output[2]);
+        output += 3;
+    }
+}
+
+void FrameStreamer::convertToYuv(const DisplayData& displayData)
+{
+    mOutput.resize(gPixelCount * 3);
+
+    uint8_t* yPlane = mOutput.data();
+    uint8_t* uPlane = yPlane + gPixelCount;
+    uint8_t* vPlane = uPlane + gPixelCount;
+
+    // BT.601 limited range in fixed point
+    for (uint32_t index = 0; index < gPixelCount; index++)
+    {
+        uint8_t red, green, blue;
+        hostToRgb(displayData[index], red, green, blue);
+
+        yPlane[index] = static_cast<uint8_t>(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+        uPlane[index] = static_cast<uint8_t>(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+        vPlane[index] = static_cast<uint8_t>(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+    }
+}
+
+void FrameStreamer::hostToRgb(const uint32_t pixel, uint8_t& red, uint8_t& green, uint8_t& blue) const
+{
+    if (mPixelFormat == ColorTable::PixelFormat::rgb565)
+    {
+        const uint8_t red5 = (pixel >> 11) & 0x1F;
+        const uint8_t green6 = (pixel >> 5) & 0x3F;
+        const uint8_t blue5 = pixel & 0x1F;
+
+        red = (red5 << 3) | (red5 >> 2);
+        green = (green6 << 2) | (green6 >> 4);
+        blue = (blue5 << 3) | (blue5 >> 2);
+        return;
+    }
+
+    red = (pixel >> 16) & 0xFF;
+    green = (pixel >> 8) & 0xFF;
+    blue = pixel & 0xFF;
+}
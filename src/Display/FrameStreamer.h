@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../Application/ApplicationDefines.h"
+#include "ColorTable.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*  @ingroup Display
+
+    writes completed frames to a file or pipe for offline encoding, e.g. from headless regression runs.
+    Frames are copied into pooled buffers and written by a background thread, so the emulation thread never
+    waits for the disk. The pool grows instead of blocking if the writer falls behind.
+*/
+
+class FrameStreamer
+{
+public:
+    enum class Format : uint8_t
+    {
+        raw_rgb = 0, // packed 24 bit RGB frames without any header
+        y4m = 1 // YUV4MPEG2, 4:4:4
+    };
+
+    FrameStreamer() = default;
+    ~FrameStreamer();
+
+    // "-" writes to stdout. With skipDuplicates, frames identical to their predecessor are left out of the stream,
+    // which stays a standard one, and the time of every frame written goes to <fileName>.timestamps in the
+    // timestamp format v2 of mkvmerge, which puts the frames back on their original times. Skipping needs that
+    // file next to the stream, so it fails for stdout
+    bool open(const std::string& fileName, const Format format, const ColorTable::PixelFormat pixelFormat, const bool skipDuplicates = false);
+    void close();
+
+    bool isOpen() const { return mFile != nullptr; }
+
+    // called by the emulation thread for every completed frame
+    void submit(const DisplayFrame& frame);
+
+    uint64_t framesWritten() const;
+    uint64_t duplicatesSkipped() const;
+
+private:
+    struct PendingFrame
+    {
+        std::unique_ptr<DisplayData> displayData; // empty for a duplicate
+        uint64_t frameIndex;
+    };
+
+    void writerLoop();
+    void writeFrame(const DisplayData& displayData, const uint64_t frameIndex);
+    void writeOutput(const uint64_t frameIndex);
+
+    void convertToRgb(const DisplayData& displayData);
+    void convertToYuv(const DisplayData& displayData);
+    void hostToRgb(const uint32_t pixel, uint8_t& red, uint8_t& green, uint8_t& blue) const;
+
+    std::FILE* mFile {};
+    std::FILE* mTimestampFile {};
+    bool mOwnsFile {};
+
+    Format mFormat { Format::raw_rgb };
+    ColorTable::PixelFormat mPixelFormat { ColorTable::PixelFormat::argb8888 };
+    bool mSkipDuplicates {};
+
+    // emulation thread only
+    uint64_t mLastContentVersion {};
+    uint64_t mFrameIndex {};
+
+    // writer thread only. Keeps the last frame written, to end the stream with it after a run of duplicates
+    std::vector<uint8_t> mOutput;
+
+    std::thread mWriter;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<PendingFrame> mQueue;
+    std::vector<std::unique_ptr<DisplayData>> mFreeBuffers;
+    uint64_t mFramesWritten {};
+    uint64_t mDuplicatesSkipped {};
+    bool mStopWriter {};
+};
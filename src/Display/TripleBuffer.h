@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*  @ingroup Display
+
+    lock-free hand-off of buffers between exactly one producer and one consumer thread.
+    The producer owns the back buffer, the consumer owns the front buffer, and the third buffer is exchanged
+    between them by swapping an index. Neither side ever waits for or copies the other's data.
+*/
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    ~TripleBuffer() = default;
+
+    // producer side
+    T& backBuffer() { return mBuffers[mBackIndex]; }
+    uint8_t backIndex() const { return mBackIndex; }
+
+    // hands the back buffer to the consumer and continues with the buffer it gave up
+    void publish()
+    {
+        const uint8_t previous = mMiddle.exchange(mBackIndex | freshBit, std::memory_order_acq_rel);
+        mBackIndex = previous & indexMask;
+    }
+
+    // consumer side. Returns false if nothing was published since the last call
+    bool acquire()
+    {
+        if ((mMiddle.load(std::memory_order_relaxed) & freshBit) == 0) return false;
+
+        const uint8_t previous = mMiddle.exchange(mFrontIndex, std::memory_order_acq_rel);
+        mFrontIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& frontBuffer() const { return mBuffers[mFrontIndex]; }
+
+private:
+    static constexpr uint8_t indexMask = 0b011;
+    static constexpr uint8_t freshBit = 0b100;
+
+    std::array<T, 3> mBuffers {};
+
+    // producer and consumer indices live on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<uint8_t> mMiddle { 1 };
+    alignas(64) uint8_t mBackIndex { 0 };
+    alignas(64) uint8_t mFrontIndex { 2 };
+};
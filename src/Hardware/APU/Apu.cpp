@@ -0,0 +1,616 @@
+#include "Apu.h"
+
+#include "../../Application/ApplicationDefines.h"
+#include "../SaveState/StateBuffer.h"
+
+#include <algorithm>
+
+Apu::Apu()
+{
+    setSampleRate(apuSampleRate);
+}
+
+void Apu::setSampleRate(const uint32_t sampleRate)
+{
+    mSampleRate = sampleRate;
+    mLeft.setRates(gClockRate, sampleRate);
+    mRight.setRates(gClockRate, sampleRate);
+}
+
+void Apu::setSynthesisEnabled(const bool enabled)
+{
+    if (enabled == mSynthesisEnabled) return;
+
+    // catch up in the previous mode
+    synthesize();
+    mSynthesisEnabled = enabled;
+
+    if (enabled == false) return;
+
+    // the waveforms restart where the channels are now, from silence
+    for (Channel& channel : mChannels)
+    {
+        channel.nextStep = mSynthesizedTime + channel.period;
+        channel.output = {};
+    }
+    mLeft.allocate();
+    mRight.allocate();
+    mLeft.clear();
+    mRight.clear();
+
+    updateAllOutputs(mSynthesizedTime);
+}
+
+uint8_t Apu::readRegister(const uint16_t address)
+{
+    if (address >= waveRamStart) return registerAt(address);
+
+    if (address == soundControlRegister)
+    {
+        // length counters may have run out since the last access
+        synthesize();
+
+        uint8_t status = audioReadMasks[address - audioRegistersStart] | (mPowered ? 0x80 : 0x00);
+        for (uint8_t id = 0; id < audioChannelCount; id++)
+        {
+            if (mChannels[id].enabled) status |= (1 << id);
+        }
+        return status;
+    }
+
+    return registerAt(address) | audioReadMasks[address - audioRegistersStart];
+}
+
+void Apu::writeRegister(const uint16_t address, const uint8_t value)
+{
+    // everything up to now is generated with the previous register values
+    synthesize();
+
+    if (address >= waveRamStart)
+    {
+        registerAt(address) = value;
+        if (mChannels[wave].enabled) updateOutput(wave, mSynthesizedTime);
+        return;
+    }
+
+    if (address == soundControlRegister)
+    {
+        const bool powered = (value & 0x80) != 0;
+        if (powered == mPowered) return;
+
+        if (powered)
+        {
+            mPowered = true;
+            mSequencerStep = 0;
+        }
+        else
+        {
+            powerOff();
+        }
+        return;
+    }
+
+    // the registers cannot be written while the APU is off
+    if (mPowered == false) return;
+
+    registerAt(address) = value;
+
+    if (address == masterVolumeRegister || address == soundPanningRegister)
+    {
+        updateAllOutputs(mSynthesizedTime);
+        return;
+    }
+
+    const uint8_t offset = address - audioRegistersStart;
+    if (offset >= audioChannelCount * 5) return;
+
+    const ChannelId id = static_cast<ChannelId>(offset / 5);
+    Channel& channel = mChannels[id];
+
+    switch (offset % 5)
+    {
+        case 0:
+        {
+            if (id == wave)
+            {
+                channel.dacEnabled = (value & 0x80) != 0;
+                if (channel.dacEnabled == false) channel.enabled = false;
+            }
+            break;
+        }
+        case 1:
+        {
+            if (id == wave)
+            {
+                channel.lengthCounter = waveLengthMax - value;
+            }
+            else
+            {
+                channel.lengthCounter = (id == noise ? noiseLengthMax : squareLengthMax) - (value & 0x3F);
+            }
+            break;
+        }
+        case 2:
+        {
+            if (id != wave)
+            {
+                channel.dacEnabled = (value & 0xF8) != 0;
+                if (channel.dacEnabled == false) channel.enabled = false;
+            }
+            break;
+        }
+        case 3:
+        {
+            if (id != noise) channel.frequency = (channel.frequency & 0x700) | value;
+            updatePeriod(id);
+            break;
+        }
+        case 4:
+        {
+            channel.lengthEnabled = (value & 0x40) != 0;
+            if (id != noise)
+            {
+                channel.frequency = (channel.frequency & 0xFF) | ((value & 0b111) << 8);
+                updatePeriod(id);
+            }
+
+            if (value & 0x80) trigger(id);
+            break;
+        }
+    }
+
+    updateOutput(id, mSynthesizedTime);
+}
+
+void Apu::endFrame()
+{
+    synthesize();
+
+    if (mSynthesisEnabled)
+    {
+        mLeft.endFrame(mTime);
+        mRight.endFrame(mTime);
+    }
+    mStatistics.cyclesSynthesized += mTime;
+
+    // times are kept relative to the start of the current frame
+    for (Channel& channel : mChannels)
+    {
+        channel.nextStep = channel.nextStep > mTime ? channel.nextStep - mTime : 0;
+    }
+    mNextSequencerStep -= mTime;
+
+    mTime = 0;
+    mSynthesizedTime = 0;
+}
+
+uint32_t Apu::samplesAvailable() const
+{
+    return mLeft.samplesAvailable();
+}
+
+uint32_t Apu::readSamples(int16_t* samples, const uint32_t count)
+{
+    mRight.readSamples(samples + 1, count, 2);
+    return mLeft.readSamples(samples, count, 2);
+}
+
+void Apu::discardSamples(const uint32_t count)
+{
+    mLeft.removeSamples(count);
+    mRight.removeSamples(count);
+}
+
+std::chrono::nanoseconds Apu::synthesisCostPerSecond() const
+{
+    if (mStatistics.cyclesSynthesized == 0) return {};
+
+    return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(mStatistics.synthesisTime.count()) * gClockRate / mStatistics.cyclesSynthesized));
+}
+
+void Apu::reset()
+{
+    mRegisters.fill(0);
+    mChannels.fill(Channel {});
+
+    mSweepShadow = 0;
+    mSweepTimer = 0;
+    mSweepEnabled = false;
+    mLfsr = 0x7FFF;
+
+    mTime = 0;
+    mSynthesizedTime = 0;
+    mNextSequencerStep = frameSequencerPeriod;
+    mSequencerStep = 0;
+
+    mPowered = false;
+
+    mLeft.clear();
+    mRight.clear();
+    mStatistics = {};
+}
+
+void Apu::synthesize()
+{
+    if (mSynthesizedTime >= mTime) return;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (mSynthesizedTime < mTime)
+    {
+        const uint32_t end = std::min(mTime, mNextSequencerStep);
+
+        // without synthesis the frame sequencer steps are the only events
+        if (mSynthesisEnabled)
+        {
+            for (uint8_t id = 0; id < audioChannelCount; id++)
+            {
+                runChannel(static_cast<ChannelId>(id), end);
+            }
+        }
+        mSynthesizedTime = end;
+
+        if (end == mNextSequencerStep)
+        {
+            mNextSequencerStep += frameSequencerPeriod;
+
+            if (mPowered)
+            {
+                stepFrameSequencer();
+                updateAllOutputs(end);
+            }
+        }
+    }
+
+    mStatistics.synthesisTime += std::chrono::steady_clock::now() - start;
+}
+
+void Apu::runChannel(const ChannelId id, const uint32_t until)
+{
+    Channel& channel = mChannels[id];
+    if (channel.enabled == false || channel.clocked == false) return;
+
+    // only the steps of the waveform are visited, never the single cycles in between
+    while (channel.nextStep <= until)
+    {
+        switch (id)
+        {
+            case square1:
+            case square2:
+            {
+                channel.position = (channel.position + 1) & 0b111;
+                break;
+            }
+            case wave:
+            {
+                channel.position = (channel.position + 1) % waveSampleCount;
+                break;
+            }
+            case noise:
+            {
+                const uint16_t feedback = (mLfsr ^ (mLfsr >> 1)) & 0b1;
+                mLfsr = (mLfsr >> 1) | (feedback << 14);
+
+                // 7 bit mode
+                if (registerAt(channel4PolynomialRegister) & 0b1000)
+                {
+                    mLfsr = (mLfsr & ~(1 << 6)) | (feedback << 6);
+                }
+                break;
+            }
+        }
+
+        updateOutput(id, channel.nextStep);
+        channel.nextStep += channel.period;
+    }
+}
+
+void Apu::updateOutput(const ChannelId id, const uint32_t time)
+{
+    if (mSynthesisEnabled == false) return;
+
+    Channel& channel = mChannels[id];
+
+    const int32_t amplitude = channelAmplitude(id) * outputGain;
+    const uint8_t panning = registerAt(soundPanningRegister);
+    const uint8_t masterVolume = registerAt(masterVolumeRegister);
+
+    const int32_t left = (panning & (0x10 << id)) ? amplitude * (((masterVolume >> 4) & 0b111) + 1) : 0;
+    const int32_t right = (panning & (0x01 << id)) ? amplitude * ((masterVolume & 0b111) + 1) : 0;
+
+    if (left != channel.output[0])
+    {
+        mLeft.addDelta(time, left - channel.output[0]);
+        channel.output[0] = left;
+    }
+    if (right != channel.output[1])
+    {
+        mRight.addDelta(time, right - channel.output[1]);
+        channel.output[1] = right;
+    }
+}
+
+void Apu::updateAllOutputs(const uint32_t time)
+{
+    for (uint8_t id = 0; id < audioChannelCount; id++)
+    {
+        updateOutput(static_cast<ChannelId>(id), time);
+    }
+}
+
+uint8_t Apu::channelAmplitude(const ChannelId id) const
+{
+    // TODO the DACs output an analog level even for a digital 0; the DC offset is left to the high pass
+    const Channel& channel = mChannels[id];
+    if (channel.enabled == false || channel.dacEnabled == false) return 0;
+
+    switch (id)
+    {
+        case square1:
+        case square2:
+        {
+            const uint8_t duty = mRegisters[channelRegister(id, 1) - audioRegistersStart] >> 6;
+            return dutyPatterns[duty][channel.position] ? channel.volume : 0;
+        }
+        case wave:
+        {
+            const uint8_t samples = mRegisters[waveRamStart - audioRegistersStart + channel.position / 2];
+            const uint8_t sample = (channel.position & 0b1) ? (samples & 0x0F) : (samples >> 4);
+
+            // 0 mutes the channel, 1 - 3 shift the sample right by 0 - 2 bits
+            const uint8_t volumeCode = (mRegisters[channel3VolumeRegister - audioRegistersStart] >> 5) & 0b11;
+            return volumeCode == 0 ? 0 : sample >> (volumeCode - 1);
+        }
+        case noise:
+        {
+            return (mLfsr & 0b1) ? 0 : channel.volume;
+        }
+    }
+
+    return 0;
+}
+
+void Apu::stepFrameSequencer()
+{
+    if ((mSequencerStep & 0b1) == 0)
+    {
+        for (Channel& channel : mChannels)
+        {
+            stepLength(channel);
+        }
+    }
+
+    if (mSequencerStep == 2 || mSequencerStep == 6)
+    {
+        stepSweep();
+    }
+
+    if (mSequencerStep == 7)
+    {
+        stepEnvelope(mChannels[square1], registerAt(channel1EnvelopeRegister));
+        stepEnvelope(mChannels[square2], registerAt(channel2EnvelopeRegister));
+        stepEnvelope(mChannels[noise], registerAt(channel4EnvelopeRegister));
+    }
+
+    mSequencerStep = (mSequencerStep + 1) & 0b111;
+}
+
+void Apu::stepLength(Channel& channel)
+{
+    if (channel.lengthEnabled == false || channel.lengthCounter == 0) return;
+
+    if (--channel.lengthCounter == 0) channel.enabled = false;
+}
+
+void Apu::stepEnvelope(Channel& channel, const uint8_t envelopeRegister)
+{
+    const uint8_t period = envelopeRegister & 0b111;
+    if (period == 0) return;
+
+    if (channel.envelopeTimer > 0) channel.envelopeTimer--;
+    if (channel.envelopeTimer > 0) return;
+
+    channel.envelopeTimer = period;
+    if (envelopeRegister & 0b1000)
+    {
+        if (channel.volume < 15) channel.volume++;
+    }
+    else if (channel.volume > 0)
+    {
+        channel.volume--;
+    }
+}
+
+void Apu::stepSweep()
+{
+    if (mSweepTimer > 0) mSweepTimer--;
+    if (mSweepTimer > 0) return;
+
+    const uint8_t sweep = registerAt(channel1SweepRegister);
+    const uint8_t period = (sweep >> 4) & 0b111;
+    mSweepTimer = period != 0 ? period : 8;
+
+    if (mSweepEnabled == false || period == 0) return;
+
+    const uint16_t frequency = calculateSweep();
+    if (frequency <= maxFrequency && (sweep & 0b111) != 0)
+    {
+        mSweepShadow = frequency;
+        mChannels[square1].frequency = frequency;
+        updatePeriod(square1);
+
+        // the new frequency is checked for an overflow right away
+        calculateSweep();
+    }
+}
+
+uint16_t Apu::calculateSweep()
+{
+    const uint8_t sweep = registerAt(channel1SweepRegister);
+    const uint16_t change = mSweepShadow >> (sweep & 0b111);
+    const uint16_t frequency = (sweep & 0b1000) ? mSweepShadow - change : mSweepShadow + change;
+
+    if (frequency > maxFrequency) mChannels[square1].enabled = false;
+
+    return frequency;
+}
+
+void Apu::trigger(const ChannelId id)
+{
+    Channel& channel = mChannels[id];
+
+    channel.enabled = channel.dacEnabled;
+    if (channel.lengthCounter == 0)
+    {
+        channel.lengthCounter = id == wave ? waveLengthMax : (id == noise ? noiseLengthMax : squareLengthMax);
+    }
+
+    updatePeriod(id);
+    channel.nextStep = mSynthesizedTime + channel.period;
+
+    if (id == wave)
+    {
+        channel.position = 0;
+    }
+    else
+    {
+        const uint8_t envelope = registerAt(channelRegister(id, 2));
+        channel.volume = envelope >> 4;
+        channel.envelopeTimer = (envelope & 0b111) != 0 ? (envelope & 0b111) : 8;
+    }
+
+    if (id == noise)
+    {
+        mLfsr = 0x7FFF;
+    }
+    else if (id == square1)
+    {
+        const uint8_t sweep = registerAt(channel1SweepRegister);
+        const uint8_t period = (sweep >> 4) & 0b111;
+
+        mSweepShadow = channel.frequency;
+        mSweepTimer = period != 0 ? period : 8;
+        mSweepEnabled = period != 0 || (sweep & 0b111) != 0;
+
+        if (sweep & 0b111) calculateSweep();
+    }
+}
+
+void Apu::updatePeriod(const ChannelId id)
+{
+    Channel& channel = mChannels[id];
+
+    switch (id)
+    {
+        case square1:
+        case square2:
+        {
+            channel.period = (2048 - channel.frequency) * 4;
+            channel.clocked = true;
+            break;
+        }
+        case wave:
+        {
+            channel.period = (2048 - channel.frequency) * 2;
+            channel.clocked = true;
+            break;
+        }
+        case noise:
+        {
+            const uint8_t polynomial = registerAt(channel4PolynomialRegister);
+            const uint8_t shift = polynomial >> 4;
+            const bool wasClocked = channel.clocked;
+
+            channel.period = static_cast<uint32_t>(noiseDivisors[polynomial & 0b111]) << shift;
+            channel.clocked = shift < 14;
+
+            if (channel.clocked && wasClocked == false) channel.nextStep = mSynthesizedTime + channel.period;
+            break;
+        }
+    }
+}
+
+void Apu::powerOff()
+{
+    // everything but the wave RAM is cleared
+    std::fill(mRegisters.begin(), mRegisters.begin() + (waveRamStart - audioRegistersStart), 0);
+
+    for (Channel& channel : mChannels)
+    {
+        channel.enabled = false;
+        channel.dacEnabled = false;
+        channel.lengthEnabled = false;
+        channel.lengthCounter = 0;
+        channel.frequency = 0;
+    }
+    mSweepEnabled = false;
+    mPowered = false;
+
+    updateAllOutputs(mSynthesizedTime);
+}
+
+uint16_t Apu::channelRegister(const ChannelId id, const uint8_t index)
+{
+    return audioRegistersStart + id * 5 + index;
+}
+
+void Apu::saveState(StateWriter& writer) const
+{
+    writer.write(mRegisters);
+    writer.write(mChannels);
+
+    writer.write(mSweepShadow);
+    writer.write(mSweepTimer);
+    writer.write(mSweepEnabled);
+    writer.write(mLfsr);
+
+    writer.write(mTime);
+    writer.write(mSynthesizedTime);
+    writer.write(mNextSequencerStep);
+    writer.write(mSequencerStep);
+    writer.write(mPowered);
+
+    // samples of the current frame that are already synthesized
+    mLeft.saveState(writer, mSynthesizedTime);
+    mRight.saveState(writer, mSynthesizedTime);
+}
+
+void Apu::loadState(StateReader& reader)
+{
+    reader.read(mRegisters);
+    reader.read(mChannels);
+
+    reader.read(mSweepShadow);
+    reader.read(mSweepTimer);
+    reader.read(mSweepEnabled);
+    reader.read(mLfsr);
+
+    reader.read(mTime);
+    reader.read(mSynthesizedTime);
+    reader.read(mNextSequencerStep);
+    reader.read(mSequencerStep);
+    reader.read(mPowered);
+
+    mLeft.loadState(reader);
+    mRight.loadState(reader);
+}
+
+void Apu::forkFrom(const Apu& parent)
+{
+    mRegisters = parent.mRegisters;
+    mChannels = parent.mChannels;
+
+    mSweepShadow = parent.mSweepShadow;
+    mSweepTimer = parent.mSweepTimer;
+    mSweepEnabled = parent.mSweepEnabled;
+    mLfsr = parent.mLfsr;
+
+    mTime = parent.mTime;
+    mSynthesizedTime = parent.mSynthesizedTime;
+    mNextSequencerStep = parent.mNextSequencerStep;
+    mSequencerStep = parent.mSequencerStep;
+    mPowered = parent.mPowered;
+
+    // the sample buffers are not copied; they get cleared when synthesis is enabled again
+    mSynthesisEnabled = false;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "ApuDefines.h"
+#include "BlipBuffer.h"
+#include "../Memory/MemoryDefines.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup APU
+
+    the sound unit with its two square channels, the wave channel and the noise channel.
+    tick() only advances the clock. The channels are synthesized in one batch whenever a sound register is
+    accessed or a frame ends, so only the changes of the output level between two accesses get generated;
+    the BlipBuffers turn these into band-limited samples.
+*/
+
+class Apu
+{
+public:
+    Apu();
+    ~Apu() = default;
+
+    struct SynthesisStatistics
+    {
+        std::chrono::nanoseconds synthesisTime {};
+        uint64_t cyclesSynthesized {};
+    };
+
+    // drops all buffered samples
+    void setSampleRate(const uint32_t sampleRate);
+    uint32_t sampleRate() const { return mSampleRate; }
+
+    /*  without synthesis only the state the CPU can observe is kept up to date: the frame sequencer with its
+        length counters, sweep and envelopes, and thereby the channel status bits in NR52. Nothing else gets
+        generated, so no samples are produced. Re-enabling continues with the channels' current state.
+        A new APU starts without synthesis
+    */
+    void setSynthesisEnabled(const bool enabled);
+    bool synthesisEnabled() const { return mSynthesisEnabled; }
+
+    // advances the APU by the given amount of T-cycles
+    void tick(const uint16_t cycles) { mTime += cycles; }
+
+    // 0xFF10 - 0xFF3F
+    uint8_t readRegister(const uint16_t address);
+    void writeRegister(const uint16_t address, const uint8_t value);
+
+    // synthesizes everything up to now and makes the samples available for reading
+    void endFrame();
+
+    uint32_t samplesAvailable() const;
+
+    // interleaved stereo (left, right); count is given in sample pairs
+    uint32_t readSamples(int16_t* samples, const uint32_t count);
+    void discardSamples(const uint32_t count);
+
+    const SynthesisStatistics& statistics() const { return mStatistics; }
+
+    // synthesis time needed for one second of audio
+    std::chrono::nanoseconds synthesisCostPerSecond() const;
+
+    void reset();
+
+    // the sample rate and whether synthesis is enabled are settings of the host and not part of the state
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+    // copies the state of parent but no samples. The copy has synthesis disabled; enabling it starts from silence
+    void forkFrom(const Apu& parent);
+
+private:
+    enum ChannelId : uint8_t
+    {
+        square1 = 0,
+        square2 = 1,
+        wave = 2,
+        noise = 3
+    };
+
+    struct Channel
+    {
+        bool enabled {};
+        bool dacEnabled {};
+        bool lengthEnabled {};
+        bool clocked {}; // noise channels with a clock shift of 14 or 15 never step
+
+        uint16_t lengthCounter {};
+        uint16_t frequency {};
+
+        uint32_t period {}; // T-cycles per waveform step
+        uint32_t nextStep {}; // time of the next waveform step
+
+        uint8_t position {}; // duty step or wave sample
+        uint8_t volume {};
+        uint8_t envelopeTimer {};
+
+        std::array<int32_t, 2> output {}; // level last handed to the left and right buffer
+    };
+
+    uint8_t& registerAt(const uint16_t address) { return mRegisters[address - audioRegistersStart]; }
+
+    void synthesize();
+    void runChannel(const ChannelId id, const uint32_t until);
+    void updateOutput(const ChannelId id, const uint32_t time);
+    void updateAllOutputs(const uint32_t time);
+    uint8_t channelAmplitude(const ChannelId id) const;
+
+    void stepFrameSequencer();
+    void stepLength(Channel& channel);
+    void stepEnvelope(Channel& channel, const uint8_t envelopeRegister);
+    void stepSweep();
+    uint16_t calculateSweep();
+
+    void trigger(const ChannelId id);
+    void updatePeriod(const ChannelId id);
+    void powerOff();
+
+    static uint16_t channelRegister(const ChannelId id, const uint8_t index);
+
+    std::array<uint8_t, audioRegistersEnd - audioRegistersStart + 1> mRegisters {};
+    std::array<Channel, audioChannelCount> mChannels {};
+
+    // channel 1 frequency sweep
+    uint16_t mSweepShadow {};
+    uint8_t mSweepTimer {};
+    bool mSweepEnabled {};
+
+    uint16_t mLfsr { 0x7FFF };
+
+    uint32_t mTime {}; // T-cycles since the last endFrame
+    uint32_t mSynthesizedTime {};
+    uint32_t mNextSequencerStep { frameSequencerPeriod };
+    uint8_t mSequencerStep {};
+
+    bool mPowered {};
+    bool mSynthesisEnabled {}; // the sample buffers get allocated the first time it is enabled
+
+    uint32_t mSampleRate { apuSampleRate };
+    BlipBuffer mLeft;
+    BlipBuffer mRight;
+
+    SynthesisStatistics mStatistics {};
+};
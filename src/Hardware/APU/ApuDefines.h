@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// the APU renders at a fixed rate derived from the clock (4194304 / 64); the audio output resamples it to the device rate
+static constexpr uint32_t apuSampleRate = 65536;
+
+// the frame sequencer clocks length (256 Hz), sweep (128 Hz) and envelopes (64 Hz)
+static constexpr uint16_t frameSequencerPeriod = 8192;
+
+static constexpr uint8_t audioChannelCount = 4;
+static constexpr uint16_t maxFrequency = 2047;
+
+static constexpr uint8_t waveSampleCount = 32;
+
+// length counters count up to these values
+static constexpr uint16_t squareLengthMax = 64;
+static constexpr uint16_t waveLengthMax = 256;
+static constexpr uint16_t noiseLengthMax = 64;
+
+// largest channel amplitude times largest master volume (4 channels * 15 * 8) stays within 16 bit
+static constexpr int16_t outputGain = 60;
+
+static constexpr std::array<std::array<uint8_t, 8>, 4> dutyPatterns {{
+    { 0, 0, 0, 0, 0, 0, 0, 1 }, // 12.5 %
+    { 1, 0, 0, 0, 0, 0, 0, 1 }, // 25 %
+    { 1, 0, 0, 0, 0, 1, 1, 1 }, // 50 %
+    { 0, 1, 1, 1, 1, 1, 1, 0 } // 75 %
+}};
+
+static constexpr std::array<uint8_t, 8> noiseDivisors { 8, 16, 32, 48, 64, 80, 96, 112 };
+
+// bits that always read back as 1, starting at NR10 (0xFF10 - 0xFF2F)
+static constexpr std::array<uint8_t, 0x20> audioReadMasks {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF, // NR10 - NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF, // NR20 - NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF, // NR30 - NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF, // NR40 - NR44
+    0x00, 0x00, 0x70, // NR50 - NR52
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
@@ -0,0 +1,187 @@
+#include "BlipBuffer.h"
+
+#include "../SaveState/StateBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// 200 ms of audio can be buffered before the oldest samples are dropped
+static constexpr uint32_t gBufferDivisor = 5;
+
+BlipBuffer::BlipBuffer()
+{
+    setRates(4194304, 48000);
+}
+
+void BlipBuffer::setRates(const uint32_t clockRate, const uint32_t sampleRate)
+{
+    mFactor = (static_cast<uint64_t>(sampleRate) << fractionBits) / clockRate;
+    mBufferSize = sampleRate / gBufferDivisor + kernelWidth;
+    if (allocated()) mBuffer.assign(mBufferSize, 0);
+
+    clear();
+}
+
+void BlipBuffer::allocate()
+{
+    if (mBuffer.size() == mBufferSize) return;
+
+    mBuffer.assign(mBufferSize, 0);
+    clear();
+}
+
+void BlipBuffer::addDelta(const uint32_t time, const int32_t delta)
+{
+    const uint64_t position = mOffset + time * mFactor;
+    const uint32_t index = mAvailable + static_cast<uint32_t>(position >> fractionBits);
+
+    // changes this far ahead can only happen if endFrame is not called; they are lost rather than overflowing
+    if (index + kernelWidth > mBuffer.size()) return;
+
+    const Kernel& kernel = kernels()[(position >> (fractionBits - phaseBits)) & (phaseCount - 1)];
+    int32_t* target = &mBuffer[index];
+    for (uint8_t tap = 0; tap < kernelWidth; tap++)
+    {
+        target[tap] += kernel[tap] * delta;
+    }
+}
+
+void BlipBuffer::endFrame(const uint32_t time)
+{
+    if (allocated() == false) return;
+
+    const uint64_t position = mOffset + time * mFactor;
+    const uint32_t newSamples = static_cast<uint32_t>(position >> fractionBits);
+    mOffset = position & ((static_cast<uint64_t>(1) << fractionBits) - 1);
+
+    // nobody reads the samples fast enough; forget the oldest ones
+    const uint32_t capacity = mBuffer.size() - kernelWidth;
+    if (mAvailable + newSamples > capacity)
+    {
+        removeSamples(std::min(mAvailable, mAvailable + newSamples - capacity));
+    }
+
+    mAvailable = std::min(mAvailable + newSamples, capacity);
+}
+
+uint32_t BlipBuffer::readSamples(int16_t* samples, const uint32_t count, const uint8_t stride)
+{
+    return integrate(samples, count, stride);
+}
+
+void BlipBuffer::removeSamples(const uint32_t count)
+{
+    integrate(nullptr, count, 0);
+}
+
+void BlipBuffer::clear()
+{
+    std::fill(mBuffer.begin(), mBuffer.end(), 0);
+    mOffset = 0;
+    mAvailable = 0;
+    mIntegrator = 0;
+}
+
+void BlipBuffer::saveState(StateWriter& writer, const uint32_t pendingTime) const
+{
+    writer.write(mOffset);
+    writer.write(mIntegrator);
+
+    const uint64_t pendingSamples = (mOffset + pendingTime * mFactor) >> fractionBits;
+    const uint32_t pendingSize = static_cast<uint32_t>(std::min<uint64_t>(mBuffer.size() - mAvailable, pendingSamples + kernelWidth));
+    writer.write(pendingSize);
+    writer.writeBytes(mBuffer.data() + mAvailable, pendingSize * sizeof(int32_t));
+}
+
+void BlipBuffer::loadState(StateReader& reader)
+{
+    reader.read(mOffset);
+    reader.read(mIntegrator);
+    mAvailable = 0;
+
+    uint32_t pendingSize = 0;
+    reader.read(pendingSize);
+    if (pendingSize > mBufferSize)
+    {
+        // written with other rates
+        reader.fail();
+        clear();
+        return;
+    }
+
+    if (pendingSize > 0) allocate();
+
+    reader.readBytes(mBuffer.data(), pendingSize * sizeof(int32_t));
+    std::fill(mBuffer.begin() + pendingSize, mBuffer.end(), 0);
+}
+
+uint32_t BlipBuffer::integrate(int16_t* samples, const uint32_t count, const uint8_t stride)
+{
+    const uint32_t sampleCount = std::min(count, mAvailable);
+    if (sampleCount == 0) return 0;
+
+    int32_t integrator = mIntegrator;
+    for (uint32_t index = 0; index < sampleCount; index++)
+    {
+        integrator += mBuffer[index];
+
+        const int32_t sample = integrator >> kernelBits;
+        if (samples)
+        {
+            samples[index * stride] = static_cast<int16_t>(std::clamp(sample, -32768, 32767));
+        }
+
+        integrator -= sample * (1 << (kernelBits - bassShift));
+    }
+    mIntegrator = integrator;
+
+    // the impulses of following samples, including those of the unfinished frame, move to the front
+    std::memmove(mBuffer.data(), mBuffer.data() + sampleCount, (mBuffer.size() - sampleCount) * sizeof(int32_t));
+    std::fill(mBuffer.end() - sampleCount, mBuffer.end(), 0);
+    mAvailable -= sampleCount;
+
+    return sampleCount;
+}
+
+const BlipBuffer::KernelTable& BlipBuffer::kernels()
+{
+    static const KernelTable table = buildKernels();
+    return table;
+}
+
+BlipBuffer::KernelTable BlipBuffer::buildKernels()
+{
+    // Blackman windowed sinc with its cutoff a bit below the Nyquist frequency
+    static constexpr double cutoff = 0.9;
+    static constexpr double pi = 3.14159265358979323846;
+    static constexpr double halfWidth = kernelWidth / 2;
+
+    KernelTable table {};
+    for (uint8_t phase = 0; phase < phaseCount; phase++)
+    {
+        std::array<double, kernelWidth> values {};
+        double sum = 0.0;
+
+        for (uint8_t tap = 0; tap < kernelWidth; tap++)
+        {
+            const double x = tap + 1 - halfWidth - static_cast<double>(phase) / phaseCount;
+            const double sinc = x == 0.0 ? cutoff : std::sin(pi * cutoff * x) / (pi * x);
+            const double window = std::abs(x) >= halfWidth ? 0.0 : 0.42 + 0.5 * std::cos(pi * x / halfWidth) + 0.08 * std::cos(2.0 * pi * x / halfWidth);
+
+            values[tap] = sinc * window;
+            sum += values[tap];
+        }
+
+        // every kernel has to add up to exactly one step, or the integrated output drifts
+        int32_t total = 0;
+        for (uint8_t tap = 0; tap < kernelWidth; tap++)
+        {
+            table[phase][tap] = static_cast<int16_t>(std::lround(values[tap] / sum * (1 << kernelBits)));
+            total += table[phase][tap];
+        }
+        table[phase][kernelWidth / 2] += static_cast<int16_t>((1 << kernelBits) - total);
+    }
+
+    return table;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup APU
+
+    band-limited synthesis of step waveforms (blip buffer).
+    Channels only report the points in time at which their output level changes. Each change is added as a
+    windowed sinc impulse at its sub-sample position; integrating the impulses when reading gives band-limited
+    steps without any aliasing from the square waves. The cost depends on the number of level changes, not on
+    the amount of emulated cycles.
+*/
+
+class BlipBuffer
+{
+public:
+    BlipBuffer();
+    ~BlipBuffer() = default;
+
+    // drops all samples
+    void setRates(const uint32_t clockRate, const uint32_t sampleRate);
+
+    /*  the buffer only gets allocated once samples are wanted, so machines that never produce sound do not
+        carry it. Until then changes are dropped and no samples become available
+    */
+    void allocate();
+    bool allocated() const { return !mBuffer.empty(); }
+
+    // time is given in clocks since the end of the previous frame
+    void addDelta(const uint32_t time, const int32_t delta);
+
+    // completes the samples up to the given time; the next frame starts there
+    void endFrame(const uint32_t time);
+
+    uint32_t samplesAvailable() const { return mAvailable; }
+
+    // writes up to count samples, stride apart, and removes them from the buffer
+    uint32_t readSamples(int16_t* samples, const uint32_t count, const uint8_t stride);
+    void removeSamples(const uint32_t count);
+
+    void clear();
+
+    // only the impulses of the unfinished frame up to pendingTime (clocks since the end of the previous frame)
+    // get written; samples that are finished but not read yet are output of the host and not part of the state
+    void saveState(StateWriter& writer, const uint32_t pendingTime) const;
+    void loadState(StateReader& reader);
+
+private:
+    static constexpr uint8_t phaseBits = 5;
+    static constexpr uint8_t phaseCount = 1 << phaseBits;
+    static constexpr uint8_t kernelWidth = 16;
+    static constexpr uint8_t kernelBits = 15; // a kernel sums up to 1 << kernelBits
+    static constexpr uint8_t fractionBits = 32;
+    static constexpr uint8_t bassShift = 9; // high pass which removes the DC offset of the channels
+
+    using Kernel = std::array<int16_t, kernelWidth>;
+    using KernelTable = std::array<Kernel, phaseCount>;
+
+    static const KernelTable& kernels();
+    static KernelTable buildKernels();
+
+    uint32_t integrate(int16_t* samples, const uint32_t count, const uint8_t stride);
+
+    uint64_t mFactor {}; // samples per clock in 32.32 fixed point
+    uint64_t mOffset {}; // fraction of the first unfinished sample
+    uint32_t mAvailable {};
+    int32_t mIntegrator {};
+
+    uint32_t mBufferSize {}; // once allocated
+    std::vector<int32_t> mBuffer; // impulses; samples are their running sum
+};
@@ -1,5 +1,7 @@
 #include "Alu.h"
 
+#include "../../SaveState/StateBuffer.h"
+
 #include <bitset>
 
 Alu::Alu(Registers& registers)
@@ -18,30 +20,24 @@ void Alu::resetMemory()
 
 void Alu::incrementRegister(const uint8_t givenRegister)
 {
-    mMemory = mRegisters.smallRegisterValue(givenRegister) + 1;
+    mRegisters.setFlagsRegister(AluSpecification::increment(mRegisters.smallRegisterValue(givenRegister), mRegisters.flagsRegister(), mMemory));
     mRegisters.setSmallRegister(givenRegister, mMemory);
-
-    setFlagsAfterOperation(Alu::AluOperationType::add, false);
 }
 
 void Alu::decrementRegister(const uint8_t givenRegister)
 {
-    mMemory = mRegisters.smallRegisterValue(givenRegister) - 1;
+    mRegisters.setFlagsRegister(AluSpecification::decrement(mRegisters.smallRegisterValue(givenRegister), mRegisters.flagsRegister(), mMemory));
     mRegisters.setSmallRegister(givenRegister, mMemory);
-
-    setFlagsAfterOperation(Alu::AluOperationType::subtract, false);
 }
 
 void Alu::incrementValue(const uint8_t givenValue)
 {
-    mMemory = givenValue + 1;
-    setFlagsAfterOperation(Alu::AluOperationType::add, false);
+    mRegisters.setFlagsRegister(AluSpecification::increment(givenValue, mRegisters.flagsRegister(), mMemory));
 }
 
 void Alu::decrementValue(const uint8_t givenValue)
 {
-    mMemory = givenValue - 1;
-    setFlagsAfterOperation(Alu::AluOperationType::subtract, false);
+    mRegisters.setFlagsRegister(AluSpecification::decrement(givenValue, mRegisters.flagsRegister(), mMemory));
 }
 
 void Alu::addToRegister(const uint8_t registerId, const uint8_t value)
@@ -114,49 +110,8 @@ void Alu::flipRegister(const uint8_t registerId)
 
 void Alu::arithmeticAccumulatorOperation(const uint8_t otherValue, const AluOperationType opType)
 {
-    mMemory = mRegisters.accumulator();
-
-    switch (opType)
-    {
-        case AluOperationType::add_plus_carry:
-        case AluOperationType::add:
-        {
-            mMemory += otherValue;
-            if (opType == AluOperationType::add_plus_carry)
-            {
-                mMemory += !!mRegisters.flagValue(Registers::FlagsPosition::carry_flag);
-            }
-            break;
-        }
-        case AluOperationType::subtract_plus_carry:
-        case AluOperationType::subtract:
-        case AluOperationType::compare:
-        {
-            mMemory -= otherValue;
-            if (opType == AluOperationType::subtract_plus_carry)
-            {
-                mMemory -= !!mRegisters.flagValue(Registers::FlagsPosition::carry_flag);
-            }
-            break;
-        }
-        case AluOperationType::logical_and:
-        {
-            mMemory &= otherValue;
-            break;
-        }
-        case AluOperationType::logical_xor:
-        {
-            mMemory ^=  otherValue;
-            break;
-        }
-        case AluOperationType::logical_or:
-        {
-            mMemory |= otherValue;
-            break;
-        }
-    }
-
-    setFlagsAfterOperation(opType, true);
+    const uint8_t flags = AluSpecification::accumulatorOperation(opType, mRegisters.accumulator(), otherValue, mRegisters.flagsRegister(), mMemory);
+    mRegisters.setFlagsRegister(flags);
 
     if (opType != Alu::AluOperationType::compare)
     {
@@ -226,38 +181,15 @@ void Alu::decimalAdjustAccumulator()
 
 void Alu::setFlagsAfterOperation(const AluOperationType opType, const bool includeCarryFlag, const bool includeZeroFlag)
 {
-    switch (opType)
-    {
-        case AluOperationType::add_plus_carry:
-        case AluOperationType::add:
-        {
-            mRegisters.setFlagValue(Registers::FlagsPosition::subtraction_flag, false);
-            mRegisters.setFlagValue(Registers::FlagsPosition::half_carry_flag, (((mMemory >> 3) & 0b1) == 0b1));
-            if (includeCarryFlag) mRegisters.setFlagValue(Registers::FlagsPosition::carry_flag, (((mMemory >> 7) & 0b1) == 0b1));
-
-            break;
-        }
-        case AluOperationType::subtract_plus_carry:
-        case AluOperationType::subtract:
-        case AluOperationType::compare:
-        {
-            mRegisters.setFlagValue(Registers::FlagsPosition::subtraction_flag, true);
-            mRegisters.setFlagValue(Registers::FlagsPosition::half_carry_flag, (((mMemory >> 3) & 0b1) == 0b1));
-            if (includeCarryFlag) mRegisters.setFlagValue(Registers::FlagsPosition::carry_flag, (((mMemory >> 7) & 0b1) == 0b1));
-
-            break;
-        }
-        case AluOperationType::logical_and:
-        case AluOperationType::logical_xor:
-        case AluOperationType::logical_or:
-        {
-            mRegisters.setFlagValue(Registers::FlagsPosition::subtraction_flag, false);
-            mRegisters.setFlagValue(Registers::FlagsPosition::half_carry_flag, opType == AluOperationType::logical_and);
-            if (includeCarryFlag) mRegisters.setFlagValue(Registers::FlagsPosition::carry_flag, false);
+    mRegisters.setFlagsRegister(AluSpecification::resultFlags(opType, mMemory, mRegisters.flagsRegister(), includeCarryFlag, includeZeroFlag));
+}
 
-            break;
-        }
-    }
+void Alu::saveState(StateWriter& writer) const
+{
+    writer.write(mMemory);
+}
 
-    if (includeZeroFlag) mRegisters.setFlagValue(Registers::FlagsPosition::zero_flag, (mMemory == 0));
-}
\ No newline at end of file
+void Alu::loadState(StateReader& reader)
+{
+    reader.read(mMemory);
+}
@@ -1,12 +1,17 @@
 #pragma once
 
+#include "AluSpecification.h"
 #include "../Registers/Registers.h"
 
 #include <cstdint>
 
+class StateReader;
+class StateWriter;
+
 /*  @ingroup CPU
 
     class that performs arithmetic operations on given 8- or 16-bit inputs. 
+    The 8-bit results and flags come from AluSpecification.
 */
 
 class Alu
@@ -18,17 +23,10 @@ public:
     uint8_t memory() const;
     void resetMemory();
 
-    enum class AluOperationType : uint8_t
-    {
-        add = 0b000,
-        add_plus_carry = 0b001,
-        subtract = 0b010,
-        subtract_plus_carry = 0b011,
-        logical_and = 0b100,
-        logical_xor = 0b101,
-        logical_or = 0b110,
-        compare = 0b111
-    };
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+    using AluOperationType = AluSpecification::Operation;
 
     enum class BitOperationType : uint8_t
     {
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+/*  @ingroup CPU
+
+    what the 8-bit ALU operations compute, written down once: results and flags as plain functions of the
+    operands, which Alu applies to the registers. The functions only use plain arithmetic and selects on the
+    values, without branches. Flags are the upper nibble of F, Z N H C from bit 7 down; the lower nibble is left
+    alone.
+*/
+
+struct AluSpecification
+{
+    enum class Operation : uint8_t
+    {
+        add = 0b000,
+        add_plus_carry = 0b001,
+        subtract = 0b010,
+        subtract_plus_carry = 0b011,
+        logical_and = 0b100,
+        logical_xor = 0b101,
+        logical_or = 0b110,
+        compare = 0b111
+    };
+
+    static constexpr uint8_t zeroFlag = 1 << 7;
+    static constexpr uint8_t subtractionFlag = 1 << 6;
+    static constexpr uint8_t halfCarryFlag = 1 << 5;
+    static constexpr uint8_t carryFlag = 1 << 4;
+
+    // the flags after an operation produced result. Carry and zero flag are only touched if asked for
+    static inline uint8_t resultFlags(const Operation operation, const uint8_t result, const uint8_t flags, const bool includeCarryFlag, const bool includeZeroFlag = true)
+    {
+        const bool logical = operation >= Operation::logical_and && operation <= Operation::logical_or;
+        const bool subtraction = operation >= Operation::subtract && operation <= Operation::subtract_plus_carry;
+        const bool subtractionFlagSet = subtraction || operation == Operation::compare;
+
+        // TODO half carry and carry are taken from bits 3 and 7 of the result instead of the actual carries
+        const uint8_t halfCarry = logical ? (operation == Operation::logical_and ? halfCarryFlag : 0) : ((result << 2) & halfCarryFlag);
+        const uint8_t carry = logical ? 0 : ((result >> 3) & carryFlag);
+
+        uint8_t keptFlags = flags & ~(subtractionFlag | halfCarryFlag);
+        uint8_t newFlags = (subtractionFlagSet ? subtractionFlag : 0) | halfCarry;
+
+        if (includeCarryFlag)
+        {
+            keptFlags &= ~carryFlag;
+            newFlags |= carry;
+        }
+        if (includeZeroFlag)
+        {
+            keptFlags &= ~zeroFlag;
+            newFlags |= result == 0 ? zeroFlag : 0;
+        }
+
+        return keptFlags | newFlags;
+    }
+
+    // A <op> operand; returns the new flags. The result is what compare discards
+    static inline uint8_t accumulatorOperation(const Operation operation, const uint8_t accumulator, const uint8_t operand, const uint8_t flags, uint8_t& result)
+    {
+        const uint8_t carry = (flags & carryFlag) ? 1 : 0;
+
+        switch (operation)
+        {
+            case Operation::add: result = accumulator + operand; break;
+            case Operation::add_plus_carry: result = accumulator + operand + carry; break;
+            case Operation::subtract:
+            case Operation::compare: result = accumulator - operand; break;
+            case Operation::subtract_plus_carry: result = accumulator - operand - carry; break;
+            case Operation::logical_and: result = accumulator & operand; break;
+            case Operation::logical_xor: result = accumulator ^ operand; break;
+            case Operation::logical_or: result = accumulator | operand; break;
+        }
+
+        return resultFlags(operation, result, flags, true);
+    }
+
+    // INC r and DEC r leave the carry flag alone
+    static inline uint8_t increment(const uint8_t value, const uint8_t flags, uint8_t& result)
+    {
+        result = value + 1;
+        return resultFlags(Operation::add, result, flags, false);
+    }
+
+    static inline uint8_t decrement(const uint8_t value, const uint8_t flags, uint8_t& result)
+    {
+        result = value - 1;
+        return resultFlags(Operation::subtract, result, flags, false);
+    }
+};
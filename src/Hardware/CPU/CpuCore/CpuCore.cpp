@@ -1,14 +1,27 @@
 #include "CpuCore.h"
 
 #include "../OpcodeCycleMap.h"
+#include "../../SaveState/StateBuffer.h"
 
 #include <cstdint>
 #include <limits>
 
-CpuCore::CpuCore()
+// the registers as the GBC boot ROM leaves them for a colour game (A = 0x11 identifies the GBC)
+static constexpr uint16_t gPostBootAf = 0x1180;
+static constexpr uint16_t gPostBootBc = 0x0000;
+static constexpr uint16_t gPostBootDe = 0xFF56;
+static constexpr uint16_t gPostBootHl = 0x000D;
+static constexpr uint16_t gPostBootStackPointer = 0xFFFE;
+
+static constexpr uint8_t gInterruptDispatchCycles = 5;
+
+CpuCore::CpuCore(MemoryManager& memoryManager)
     : mAlu(mRegisters),
-      mIdu(mRegisters)
-{}
+      mIdu(mRegisters),
+      mMemoryManager(memoryManager)
+{
+    reset();
+}
 
 void CpuCore::handleCurrentInstruction()
 {
@@ -24,6 +37,33 @@ void CpuCore::handleCurrentInstruction()
 
 void CpuCore::loadNewInstruction()
 {
+    const uint8_t pendingInterrupts = mMemoryManager.pendingInterrupts();
+    if (pendingInterrupts != 0)
+    {
+        // a pending interrupt ends HALT even while IME is off
+        mHalted = false;
+
+        if (mRegisters.interruptMasterEnable())
+        {
+            beginInterruptDispatch();
+            return;
+        }
+    }
+
+    if (mInterruptEnablePending)
+    {
+        mRegisters.setInterruptMasterEnable(true);
+        mInterruptEnablePending = false;
+    }
+
+    if (mHalted)
+    {
+        // HALT repeats itself one machine cycle at a time. TODO the HALT bug (IME off, interrupt already pending)
+        mCurrentInstruction.instructionCycles = 1;
+        mCurrentInstruction.currentCycle = 0;
+        return;
+    }
+
     mAddressBus = mRegisters.programCounter();
     mDataBus = mMemoryManager.getMemoryAtAddress(mAddressBus);
     
@@ -32,6 +72,7 @@ void CpuCore::loadNewInstruction()
     // reset Instruction struct
     mCurrentInstruction.currentCycle = 0;
     mCurrentInstruction.conditionMet = false;
+    mCurrentInstruction.interruptDispatch = false;
     mCurrentInstruction.temporalData.clear();
 
     // get opcode cycles. Undefined instructions lock the CPU
@@ -51,6 +92,12 @@ void CpuCore::loadNewInstruction()
 
 void CpuCore::executeInstruction()
 {
+    if (mCurrentInstruction.interruptDispatch)
+    {
+        dispatchInterrupt();
+        return;
+    }
+
     const uint8_t operationType = mRegisters.instructionRegister() >> 6;
     if (operationType == 0b00)
     {
@@ -98,7 +145,7 @@ void CpuCore::handleZeroZeroInstructionBlock()
                     }
                     else if (mCurrentInstruction.currentCycle == 2)
                     {
-                        const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                        const TemporalData& tempData = mCurrentInstruction.temporalData;
 
                         mAddressBus = tempData.at(0) + (tempData.at(1) << 8);
                         mDataBus = mRegisters.stackPointer() & 0xFF;
@@ -132,7 +179,7 @@ void CpuCore::handleZeroZeroInstructionBlock()
                     }
                     else if (mCurrentInstruction.currentCycle == 1)
                     {
-                        std::vector<uint8_t>& tempDataVec = mCurrentInstruction.temporalData;
+                        TemporalData& tempDataVec = mCurrentInstruction.temporalData;
                         mAddressBus = mRegisters.programCounter();
                         uint8_t& tempData = tempDataVec.at(0);
                         const bool dataBusSigned = (tempData >> 7) & 0b1;
@@ -157,7 +204,7 @@ void CpuCore::handleZeroZeroInstructionBlock()
                     }
                     else if (mCurrentInstruction.currentCycle == 2)
                     {
-                        const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                        const TemporalData& tempData = mCurrentInstruction.temporalData;
                         const uint16_t newProgramCounter = tempData.at(0) + (tempData.at(1) << 8);
 
                         mRegisters.setProgramCounter(newProgramCounter);
@@ -210,7 +257,7 @@ void CpuCore::handleZeroZeroInstructionBlock()
                     }
                     else if (mCurrentInstruction.currentCycle == 2)
                     {
-                        const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                        const TemporalData& tempData = mCurrentInstruction.temporalData;
                         const uint16_t newProgramCounter = tempData.at(0) + (tempData.at(1) << 8);
 
                         mRegisters.setProgramCounter(newProgramCounter);
@@ -251,7 +298,7 @@ void CpuCore::handleZeroZeroInstructionBlock()
                 }
                 else if (mCurrentInstruction.currentCycle == 2)
                 {
-                    const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                    const TemporalData& tempData = mCurrentInstruction.temporalData;
                     const uint16_t newValue = tempData.at(0) + (tempData.at(1) << 8);
 
                     mRegisters.setBigRegister(Registers::instructionToBigRegisterId(instructionCode), newValue);
@@ -478,7 +525,7 @@ void CpuCore::handleZeroOneInstructionBlock() // DONE
 
     if (firstRegister == 0b110 && secondRegister == 0b110) // special case: 0x76 HALT
     {
-        mRegisters.setInterruptEnable(0);
+        mHalted = true;
         return;
     }
 
@@ -672,14 +719,14 @@ void CpuCore::handleOneOneInstructionBlock()
                     case 2:
                     {
                         mAddressBus = 0x0000;
-                        const std::vector<uint8_t>& temporalData = mCurrentInstruction.temporalData;
+                        const TemporalData& temporalData = mCurrentInstruction.temporalData;
                         const uint16_t newValue = temporalData.at(0) + (temporalData.at(1) << 8);
                         
                         mRegisters.setProgramCounter(newValue);
 
-                        if (firstOperand == 0b011)
+                        if (firstOperand == 0b011) // RETI enables interrupts without EI's delay
                         {
-                            mRegisters.setInterruptEnable(1u);
+                            mRegisters.setInterruptMasterEnable(true);
                         }
 
                         break;
@@ -722,7 +769,7 @@ void CpuCore::handleOneOneInstructionBlock()
                 }
                 case 2:
                 {
-                    const std::vector<uint8_t>& temporalData = mCurrentInstruction.temporalData;
+                    const TemporalData& temporalData = mCurrentInstruction.temporalData;
                     const uint16_t newValue = temporalData.at(0) + (temporalData.at(1) << 8);
                     
                     mRegisters.setBigRegister(Registers::instructionToBigRegisterId(instructionCode), newValue);
@@ -764,7 +811,7 @@ void CpuCore::handleOneOneInstructionBlock()
                         {
                             mAddressBus = 0x0000;
 
-                            const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                            const TemporalData& tempData = mCurrentInstruction.temporalData;
                             const uint16_t newPc = tempData.at(0) + (tempData.at(1) << 8);
                             mRegisters.setProgramCounter(newPc);
                         }
@@ -813,7 +860,7 @@ void CpuCore::handleOneOneInstructionBlock()
                 }
                 else if (mCurrentInstruction.currentCycle == 2)
                 {
-                    const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                    const TemporalData& tempData = mCurrentInstruction.temporalData;
                     mAddressBus = tempData.at(0) + (tempData.at(1) << 8);
 
                     mDataBus = mRegisters.accumulator();
@@ -836,7 +883,7 @@ void CpuCore::handleOneOneInstructionBlock()
                 }
                 else if (mCurrentInstruction.currentCycle == 2)
                 {
-                    const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                    const TemporalData& tempData = mCurrentInstruction.temporalData;
 
                     mAddressBus = tempData.at(0) + (tempData.at(1) << 8);
                     mDataBus = mMemoryManager.getMemoryAtAddress(mAddressBus);
@@ -870,7 +917,7 @@ void CpuCore::handleOneOneInstructionBlock()
                     {
                         mAddressBus = 0x0000;
 
-                        const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+                        const TemporalData& tempData = mCurrentInstruction.temporalData;
                         const uint16_t newProgramCounter = tempData.at(0) + (tempData.at(1) << 8);
 
                         mRegisters.setProgramCounter(newProgramCounter);
@@ -888,11 +935,12 @@ void CpuCore::handleOneOneInstructionBlock()
             }
             else if (firstOperand == 0b110) // 0xF3 DI
             {
-                mRegisters.setInterruptEnable(0u);
+                mRegisters.setInterruptMasterEnable(false);
+                mInterruptEnablePending = false;
             }
             else if (firstOperand == 0b111) // 0xFB EI
             {
-                mRegisters.setInterruptEnable(1u);
+                mInterruptEnablePending = true;
             }
             return;
         }
@@ -1015,6 +1063,73 @@ void CpuCore::unconditionalFunctionCall()
     }
 }
 
+void CpuCore::beginInterruptDispatch()
+{
+    mRegisters.setInterruptMasterEnable(false);
+
+    mCurrentInstruction.instructionCycles = gInterruptDispatchCycles;
+    mCurrentInstruction.currentCycle = 0;
+    mCurrentInstruction.conditionMet = false;
+    mCurrentInstruction.interruptDispatch = true;
+    mCurrentInstruction.temporalData.clear();
+}
+
+void CpuCore::dispatchInterrupt()
+{
+    switch (mCurrentInstruction.currentCycle)
+    {
+        case 0:
+        {
+            // the opcode fetch that got discarded
+            break;
+        }
+        case 1:
+        {
+            mAddressBus = mRegisters.stackPointer();
+            mIdu.decrementStackPointer();
+            break;
+        }
+        case 2:
+        {
+            mAddressBus = mRegisters.stackPointer();
+            mDataBus = mRegisters.programCounter() >> 8;
+
+            mMemoryManager.writeToMemoryAddress(mAddressBus, mDataBus);
+            mIdu.decrementStackPointer();
+            break;
+        }
+        case 3:
+        {
+            // the source is picked only now: the push above may have overwritten IE. With nothing left pending,
+            // the dispatch jumps to 0x0000
+            const uint8_t pendingInterrupts = mMemoryManager.pendingInterrupts();
+
+            mAddressBus = mRegisters.stackPointer();
+            mDataBus = mRegisters.programCounter() & 0xFF;
+            mMemoryManager.writeToMemoryAddress(mAddressBus, mDataBus);
+
+            // the lowest pending bit wins
+            uint16_t vector = 0x0000;
+            for (uint8_t bit = 0; bit < 5; bit++)
+            {
+                if ((pendingInterrupts & (1 << bit)) == 0) continue;
+
+                mMemoryManager.acknowledgeInterrupt(bit);
+                vector = interruptVectorStart + bit * 8;
+                break;
+            }
+
+            mRegisters.setProgramCounter(vector);
+            break;
+        }
+        default:
+        {
+            // nothing left to do
+            break;
+        }
+    }
+}
+
 void CpuCore::conditionalFunctionCall()
 {
     switch (mCurrentInstruction.currentCycle)
@@ -1071,7 +1186,7 @@ void CpuCore::conditionalFunctionCall()
 
             mMemoryManager.writeToMemoryAddress(mAddressBus, mDataBus);
 
-            const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+            const TemporalData& tempData = mCurrentInstruction.temporalData;
             const uint16_t newProgramCounter = tempData.at(0) + (tempData.at(1) << 8);
 
             mRegisters.setProgramCounter(newProgramCounter);
@@ -1120,7 +1235,7 @@ void CpuCore::callAddress()
 
             mMemoryManager.writeToMemoryAddress(mAddressBus, mDataBus);
 
-            const std::vector<uint8_t>& temporalData = mCurrentInstruction.temporalData;
+            const TemporalData& temporalData = mCurrentInstruction.temporalData;
             const uint16_t newValue = temporalData.at(0) + (temporalData.at(1) << 8);
             mRegisters.setProgramCounter(newValue);
             break;
@@ -1180,7 +1295,7 @@ void CpuCore::conditionalReturnFromFunction()
         {
             mAddressBus = 0x0000;
 
-            const std::vector<uint8_t>& tempData = mCurrentInstruction.temporalData;
+            const TemporalData& tempData = mCurrentInstruction.temporalData;
             const uint16_t newProgramCounter = tempData.at(0) + (tempData.at(1) << 8);
 
             mRegisters.setProgramCounter(newProgramCounter);
@@ -1285,4 +1400,78 @@ void CpuCore::handleCbInstruction()
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void CpuCore::reset(const bool runBootRom)
+{
+    mRegisters.setBigRegister(Registers::BigRegisterIdentifier::register_af, runBootRom ? 0 : gPostBootAf);
+    mRegisters.setBigRegister(Registers::BigRegisterIdentifier::register_bc, runBootRom ? 0 : gPostBootBc);
+    mRegisters.setBigRegister(Registers::BigRegisterIdentifier::register_de, runBootRom ? 0 : gPostBootDe);
+    mRegisters.setBigRegister(Registers::BigRegisterIdentifier::register_hl, runBootRom ? 0 : gPostBootHl);
+    mRegisters.setStackPointer(runBootRom ? 0 : gPostBootStackPointer);
+    mRegisters.setProgramCounter(runBootRom ? 0 : cartridgetRomStart);
+    mRegisters.setInstructionRegister(0);
+    mRegisters.setInterruptMasterEnable(false);
+
+    mAlu.resetMemory();
+    mIdu.resetMemory();
+
+    // the first cycle fetches the instruction at the entry point
+    mCurrentInstruction = {};
+    mDataBus = 0;
+    mAddressBus = 0;
+
+    mHalted = false;
+    mInterruptEnablePending = false;
+}
+
+void CpuCore::saveState(StateWriter& writer) const
+{
+    mRegisters.saveState(writer);
+    mAlu.saveState(writer);
+    mIdu.saveState(writer);
+
+    writer.write(mCurrentInstruction.instructionCycles);
+    writer.write(mCurrentInstruction.currentCycle);
+    writer.write(mCurrentInstruction.conditionMet);
+    writer.write(mCurrentInstruction.interruptDispatch);
+
+    // an instruction holds at most a few bytes of operands
+    const uint8_t temporalSize = static_cast<uint8_t>(mCurrentInstruction.temporalData.size());
+    writer.write(temporalSize);
+    writer.writeBytes(mCurrentInstruction.temporalData.data(), temporalSize);
+
+    writer.write(mDataBus);
+    writer.write(mAddressBus);
+
+    writer.write(mHalted);
+    writer.write(mInterruptEnablePending);
+}
+
+void CpuCore::loadState(StateReader& reader)
+{
+    mRegisters.loadState(reader);
+    mAlu.loadState(reader);
+    mIdu.loadState(reader);
+
+    reader.read(mCurrentInstruction.instructionCycles);
+    reader.read(mCurrentInstruction.currentCycle);
+    reader.read(mCurrentInstruction.conditionMet);
+    reader.read(mCurrentInstruction.interruptDispatch);
+
+    uint8_t temporalSize = 0;
+    reader.read(temporalSize);
+    if (temporalSize > TemporalData::capacity)
+    {
+        reader.fail();
+        temporalSize = 0;
+    }
+    mCurrentInstruction.temporalData.resize(temporalSize);
+    reader.readBytes(mCurrentInstruction.temporalData.data(), temporalSize);
+
+    reader.read(mDataBus);
+    reader.read(mAddressBus);
+
+    reader.read(mHalted);
+    reader.read(mInterruptEnablePending);
+}
@@ -1,8 +1,8 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <memory>
-#include <vector>
 
 #include "../../Memory/MemoryManager.h"
 
@@ -11,26 +11,80 @@
 #include "../IDU/Idu.h"
 #include "../Registers/Registers.h"
 
+class StateReader;
+class StateWriter;
+
 class CpuCore
 {
 public:
-    CpuCore();
+    CpuCore(MemoryManager& memoryManager);
     ~CpuCore() = default;
 
+    // the operand bytes an instruction collects over its cycles; kept inline, an instruction needs two at most
+    struct TemporalData
+    {
+        static constexpr uint8_t capacity = 4;
+
+        void push_back(const uint8_t value)
+        {
+            if (count < capacity) bytes[count++] = value;
+        }
+
+        uint8_t& at(const uint8_t index) { return bytes[index]; }
+        uint8_t at(const uint8_t index) const { return bytes[index]; }
+
+        void clear() { count = 0; }
+        void resize(const uint8_t size) { count = size < capacity ? size : capacity; }
+
+        uint8_t size() const { return count; }
+        uint8_t* data() { return bytes.data(); }
+        const uint8_t* data() const { return bytes.data(); }
+
+        std::array<uint8_t, capacity> bytes {};
+        uint8_t count {};
+    };
+
     struct Instruction
     {
         uint8_t instructionCycles {};
         uint8_t currentCycle {};
 
-        std::vector<uint8_t> temporalData {};
+        TemporalData temporalData {};
 
         bool conditionMet {};
+        bool interruptDispatch {}; // not an opcode but the dispatch of an interrupt
     };
 
+    /*  the instruction boundary. Interrupts are only looked at here, with a single IE & IF test; peripherals
+        set IF while they are ticked and are never polled. With IME set, the highest-priority pending interrupt
+        is dispatched instead of fetching the next opcode
+    */
     void loadNewInstruction();
     void handleCurrentInstruction();
 
-    void reset();
+    /*  batched entry point: runs up to count machine cycles and calls tick() after every one of them, so the
+        peripherals can be advanced inline. Stops early as soon as tick() returns true.
+        Returns the amount of machine cycles that were run
+    */
+    template <typename Tick>
+    uint32_t runMachineCycles(const uint32_t count, Tick&& tick)
+    {
+        for (uint32_t cycle = 1; cycle <= count; cycle++)
+        {
+            handleCurrentInstruction();
+            if (tick()) return cycle;
+        }
+
+        return count;
+    }
+
+    /*  the state right after the boot ROM: documented post-boot registers, execution continuing at the cartridge
+        entry point. To run a boot ROM instead, all registers start cleared at 0x0000
+    */
+    void reset(const bool runBootRom = false);
+
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
 
 private:
     // methods for instructions
@@ -47,15 +101,22 @@ private:
     void conditionalReturnFromFunction();
     void handleCbInstruction();
 
+    // runs as a 5 machine cycle pseudo-instruction: two idle cycles, PC pushed, jump to the vector
+    void beginInterruptDispatch();
+    void dispatchInterrupt();
+
     ControlUnit mControlUnit;
     Registers mRegisters;
     Alu mAlu;
     Idu mIdu;
-    MemoryManager mMemoryManager;
+    MemoryManager& mMemoryManager;
 
     Instruction mCurrentInstruction {};
 
     uint8_t mDataBus {};
     uint16_t mAddressBus {};
 
+    bool mHalted {};
+    bool mInterruptEnablePending {}; // EI takes effect after the instruction following it
+
 };
\ No newline at end of file
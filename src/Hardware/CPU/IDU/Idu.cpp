@@ -1,5 +1,7 @@
 #include "Idu.h"
 
+#include "../../SaveState/StateBuffer.h"
+
 Idu::Idu(Registers& registers)
     : mRegisters(registers)
 {}
@@ -75,4 +77,14 @@ void Idu::decrementStackPointer()
 {
     mMemory = mRegisters.stackPointer() - 1;
     mRegisters.setStackPointer(mMemory);
-}
\ No newline at end of file
+}
+
+void Idu::saveState(StateWriter& writer) const
+{
+    writer.write(mMemory);
+}
+
+void Idu::loadState(StateReader& reader)
+{
+    reader.read(mMemory);
+}
@@ -4,6 +4,9 @@
 
 #include <cstdint>
 
+class StateReader;
+class StateWriter;
+
 /*  @ingroup CPU
 
     class that exclusive alters given variables by incrementation, decrementation, or by copying a given value 
@@ -18,6 +21,9 @@ public:
     uint16_t memory() const;
     void resetMemory();
 
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
     // TODO: give big register identifiers
     void increaseValue(const uint16_t givenValue);
 
@@ -1,5 +1,7 @@
 #include "Registers.h"
 
+#include "../../SaveState/StateBuffer.h"
+
 Registers::Registers()
 {}
 
@@ -97,22 +99,22 @@ void Registers::setInstructionRegister(const uint8_t instruction)
     mInstructionRegister = instruction;
 }
 
-void Registers::setInterruptEnable(const uint8_t newValue)
+void Registers::setInterruptMasterEnable(const bool enabled)
 {
-    mInterruptEnable = newValue;
+    mInterruptMasterEnable = enabled;
 }
 
 void Registers::setFlagValue(FlagsPosition pos, bool value)
 {
-    const uint8_t flagValue = value << static_cast<uint8_t>(pos);
+    const uint8_t flagMask = 1 << static_cast<uint8_t>(pos);
 
     if (value)
     {
-        mFlagsRegister |= flagValue;
+        mFlagsRegister |= flagMask;
     }
     else
     {
-        mFlagsRegister &= ~flagValue;
+        mFlagsRegister &= ~flagMask;
     }
 }
 
@@ -244,4 +246,36 @@ Registers::BigRegisterIdentifier Registers::instructionToBigRegisterId(const uin
     }
 
     return Registers::BigRegisterIdentifier::register_bc;
-}
\ No newline at end of file
+}
+
+void Registers::saveState(StateWriter& writer) const
+{
+    writer.write(mInstructionRegister);
+    writer.write(mInterruptMasterEnable);
+    writer.write(mAccumulator);
+    writer.write(mFlagsRegister);
+    writer.write(mBRegister);
+    writer.write(mCRegister);
+    writer.write(mDRegister);
+    writer.write(mERegister);
+    writer.write(mHRegister);
+    writer.write(mLRegister);
+    writer.write(mProgramCounter);
+    writer.write(mStackPointer);
+}
+
+void Registers::loadState(StateReader& reader)
+{
+    reader.read(mInstructionRegister);
+    reader.read(mInterruptMasterEnable);
+    reader.read(mAccumulator);
+    reader.read(mFlagsRegister);
+    reader.read(mBRegister);
+    reader.read(mCRegister);
+    reader.read(mDRegister);
+    reader.read(mERegister);
+    reader.read(mHRegister);
+    reader.read(mLRegister);
+    reader.read(mProgramCounter);
+    reader.read(mStackPointer);
+}
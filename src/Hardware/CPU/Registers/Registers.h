@@ -2,6 +2,9 @@
 
 #include <cstdint> 
 
+class StateReader;
+class StateWriter;
+
 class Registers
 {
 public:
@@ -52,6 +55,8 @@ public:
     uint8_t instructionRegister() const;
 
     bool flagValue(FlagsPosition pos) const;
+    uint8_t flagsRegister() const { return mFlagsRegister; }
+    bool interruptMasterEnable() const { return mInterruptMasterEnable; }
 
     uint8_t smallRegisterValue(const uint8_t identifier) const;
     uint16_t bigRegisterValue(const BigRegisterIdentifier identifier) const;
@@ -61,9 +66,10 @@ public:
     void setProgramCounter(const uint16_t newValue);
     void setAccumulator(const uint8_t newValue);
     void setInstructionRegister(const uint8_t instruction);
-    void setInterruptEnable(const uint8_t newValue);
+    void setInterruptMasterEnable(const bool enabled);
 
     void setFlagValue(FlagsPosition pos, bool value);
+    void setFlagsRegister(const uint8_t flags) { mFlagsRegister = flags; }
 
     void setSmallRegister(const uint8_t identifier, const uint8_t value);
     void setBigRegister(const BigRegisterIdentifier identifier, const uint16_t value);
@@ -72,9 +78,12 @@ public:
     bool checkFlagCondition(FlagCondition condition) const;
     static Registers::BigRegisterIdentifier instructionToBigRegisterId(const uint8_t instructionCode);
 
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
 protected:
     uint8_t mInstructionRegister {};
-    uint8_t mInterruptEnable {};
+    bool mInterruptMasterEnable {}; // IME; IE itself is a memory-mapped register
 
     uint8_t mAccumulator {};
     uint8_t mFlagsRegister {};
@@ -0,0 +1,54 @@
+#include "Joypad.h"
+
+#include "../SaveState/StateBuffer.h"
+
+uint8_t Joypad::read() const
+{
+    // the two upper bits are unused and read as 1
+    return 0b11000000 | mSelection | inputLines();
+}
+
+bool Joypad::writeSelection(const uint8_t value)
+{
+    const uint8_t previousLines = inputLines();
+    mSelection = value & 0b00110000;
+
+    // selecting a group with a pressed button pulls its line low as well
+    return (previousLines & ~inputLines() & 0x0F) != 0;
+}
+
+bool Joypad::setButtons(const uint8_t buttons)
+{
+    const uint8_t previousLines = inputLines();
+    mButtons = buttons;
+
+    return (previousLines & ~inputLines() & 0x0F) != 0;
+}
+
+void Joypad::reset()
+{
+    mSelection = 0b00110000;
+    mButtons = 0;
+}
+
+void Joypad::saveState(StateWriter& writer) const
+{
+    writer.write(mSelection);
+    writer.write(mButtons);
+}
+
+void Joypad::loadState(StateReader& reader)
+{
+    reader.read(mSelection);
+    reader.read(mButtons);
+}
+
+uint8_t Joypad::inputLines() const
+{
+    uint8_t pressed = 0;
+    if ((mSelection & 0b00010000) == 0) pressed |= mButtons & 0x0F;
+    if ((mSelection & 0b00100000) == 0) pressed |= mButtons >> 4;
+
+    // active low
+    return ~pressed & 0x0F;
+}
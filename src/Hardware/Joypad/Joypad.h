@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup Joypad
+
+    the joypad register (P1/JOYP, 0xFF00).
+    The CPU selects the direction and/or the action buttons with bits 4 and 5 and reads the selected buttons in
+    bits 0 - 3, where a pressed button reads as 0. A selected line going from 1 to 0 requests the joypad interrupt.
+*/
+
+class Joypad
+{
+public:
+    Joypad() = default;
+    ~Joypad() = default;
+
+    // bit positions in a button mask; a set bit means pressed
+    enum Button : uint8_t
+    {
+        right = 0,
+        left = 1,
+        up = 2,
+        down = 3,
+        a = 4,
+        b = 5,
+        select = 6,
+        start = 7
+    };
+
+    uint8_t read() const;
+
+    // both return true if the joypad interrupt has to be requested
+    bool writeSelection(const uint8_t value);
+    bool setButtons(const uint8_t buttons);
+
+    uint8_t buttons() const { return mButtons; }
+
+    void reset();
+
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+private:
+    uint8_t inputLines() const;
+
+    uint8_t mSelection { 0b00110000 }; // bits 4 (directions) and 5 (actions), selected when 0
+    uint8_t mButtons {};
+};
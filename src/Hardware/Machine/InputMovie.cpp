@@ -0,0 +1,184 @@
+#include "InputMovie.h"
+
+#include "../SaveState/StateBuffer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+void InputMovie::startRecording(const Machine& machine, const uint32_t keyframeInterval)
+{
+    mRomHash = machine.romHash();
+    mKeyframeInterval = std::max<uint32_t>(keyframeInterval, 1);
+
+    mChanges.clear();
+    mFrameStarts.assign(1, 0);
+
+    mKeyframes.clear();
+    mKeyframes.push_back({ 0, {} });
+    machine.saveState(mKeyframes.back().state);
+    mInitialStateHash = Machine::hashBytes(mKeyframes.back().state.data(), mKeyframes.back().state.size());
+}
+
+void InputMovie::recordFrame(const Machine& machine, const Machine::ButtonChange* changes, const size_t changeCount)
+{
+    if (mFrameStarts.empty()) return;
+
+    const uint64_t frame = frameCount();
+    if (frame > 0 && frame % mKeyframeInterval == 0)
+    {
+        mKeyframes.push_back({ frame, {} });
+        machine.saveState(mKeyframes.back().state);
+    }
+
+    mChanges.insert(mChanges.end(), changes, changes + changeCount);
+    mFrameStarts.push_back(mChanges.size());
+}
+
+bool InputMovie::save(const std::string& fileName) const
+{
+    std::vector<uint8_t> buffer;
+    StateWriter writer(buffer);
+
+    FileHeader header {};
+    header.magic = fileMagic;
+    header.version = fileVersion;
+    header.headerSize = sizeof(FileHeader);
+    header.romHash = mRomHash;
+    header.initialStateHash = mInitialStateHash;
+    header.frameCount = frameCount();
+    header.changeCount = mChanges.size();
+    header.keyframeInterval = mKeyframeInterval;
+    header.keyframeCount = static_cast<uint32_t>(mKeyframes.size());
+    writer.write(header);
+
+    for (uint64_t frame = 0; frame < header.frameCount; frame++)
+    {
+        writer.write(static_cast<uint16_t>(mFrameStarts[frame + 1] - mFrameStarts[frame]));
+    }
+
+    // a frame never lasts more than 65535 machine cycles
+    for (const Machine::ButtonChange& change : mChanges)
+    {
+        writer.write(static_cast<uint16_t>(change.machineCycle));
+        writer.write(change.buttons);
+    }
+
+    for (const Keyframe& keyframe : mKeyframes)
+    {
+        writer.write(keyframe.frame);
+        writer.write(static_cast<uint32_t>(keyframe.state.size()));
+        writer.writeBytes(keyframe.state.data(), keyframe.state.size());
+    }
+
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<bool>(file);
+}
+
+bool InputMovie::load(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) return false;
+
+    const std::vector<uint8_t> buffer { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    StateReader reader(buffer.data(), buffer.size());
+
+    FileHeader header {};
+    reader.read(header);
+    if (reader.failed()
+        || header.magic != fileMagic
+        || header.version != fileVersion
+        || header.headerSize != sizeof(FileHeader)
+        || header.keyframeCount == 0
+        || header.frameCount > reader.remaining())
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> frameStarts(1, 0);
+    frameStarts.reserve(header.frameCount + 1);
+    for (uint64_t frame = 0; frame < header.frameCount; frame++)
+    {
+        uint16_t count = 0;
+        reader.read(count);
+        frameStarts.push_back(frameStarts.back() + count);
+    }
+    if (frameStarts.back() != header.changeCount || header.changeCount > reader.remaining()) return false;
+
+    std::vector<Machine::ButtonChange> changes(header.changeCount);
+    for (Machine::ButtonChange& change : changes)
+    {
+        uint16_t machineCycle = 0;
+        reader.read(machineCycle);
+        reader.read(change.buttons);
+        change.machineCycle = machineCycle;
+    }
+
+    std::vector<Keyframe> keyframes(header.keyframeCount);
+    for (Keyframe& keyframe : keyframes)
+    {
+        uint32_t size = 0;
+        reader.read(keyframe.frame);
+        reader.read(size);
+        if (reader.failed() || size > reader.remaining() || keyframe.frame > header.frameCount) return false;
+
+        keyframe.state.resize(size);
+        reader.readBytes(keyframe.state.data(), size);
+    }
+
+    // seeking relies on the keyframes being in order, starting with the initial state
+    const bool ordered = std::is_sorted(keyframes.begin(), keyframes.end(), [](const Keyframe& first, const Keyframe& second) { return first.frame < second.frame; });
+    if (reader.failed() || ordered == false || keyframes.front().frame != 0) return false;
+    if (Machine::hashBytes(keyframes.front().state.data(), keyframes.front().state.size()) != header.initialStateHash) return false;
+
+    mRomHash = header.romHash;
+    mInitialStateHash = header.initialStateHash;
+    mKeyframeInterval = header.keyframeInterval;
+    mFrameStarts = std::move(frameStarts);
+    mChanges = std::move(changes);
+    mKeyframes = std::move(keyframes);
+    return true;
+}
+
+const Machine::ButtonChange* InputMovie::frameChanges(const uint64_t frame, size_t& changeCount) const
+{
+    if (frame >= frameCount())
+    {
+        changeCount = 0;
+        return nullptr;
+    }
+
+    changeCount = mFrameStarts[frame + 1] - mFrameStarts[frame];
+    return mChanges.data() + mFrameStarts[frame];
+}
+
+bool InputMovie::seek(Machine& machine, const uint64_t frame) const
+{
+    if (mKeyframes.empty() || frame > frameCount()) return false;
+
+    // the last keyframe at or before the target
+    const auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), frame, [](const uint64_t target, const Keyframe& keyframe) { return target < keyframe.frame; });
+    const Keyframe& keyframe = *std::prev(next);
+    if (machine.loadState(keyframe.state.data(), keyframe.state.size()) == false) return false;
+
+    // nobody sees or hears the frames in between
+    Apu& apu = machine.apu();
+    const bool synthesisEnabled = apu.synthesisEnabled();
+    apu.setSynthesisEnabled(false);
+    machine.ppu().setFrameSkipping(true);
+
+    for (uint64_t current = keyframe.frame; current < frame; current++)
+    {
+        size_t changeCount = 0;
+        const Machine::ButtonChange* changes = frameChanges(current, changeCount);
+        machine.runFrame(changes, changeCount);
+
+        apu.endFrame();
+        apu.discardSamples(apu.samplesAvailable());
+    }
+
+    machine.ppu().setFrameSkipping(false);
+    apu.setSynthesisEnabled(synthesisEnabled);
+    return true;
+}
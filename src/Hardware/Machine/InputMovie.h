@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Machine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*  @ingroup Machine
+
+    an input log that replays a session deterministically: the button changes of every frame at their machine
+    cycle, and every keyframeInterval frames the machine state at the start of that frame. The first keyframe
+    is the initial state, so a replay never depends on how the recording machine was set up; its hash
+    identifies the start of the movie. Seeking loads the nearest keyframe before the target and runs the
+    remaining frames without drawing or sound.
+*/
+
+class InputMovie
+{
+public:
+    InputMovie() = default;
+    ~InputMovie() = default;
+
+    static constexpr uint32_t fileMagic = 0x4D474342; // "BCGM"
+    static constexpr uint16_t fileVersion = 1;
+    static constexpr uint32_t defaultKeyframeInterval = 600;
+
+    struct FileHeader
+    {
+        uint32_t magic {};
+        uint16_t version {};
+        uint16_t headerSize {};
+        uint64_t romHash {};
+        uint64_t initialStateHash {};
+        uint64_t frameCount {};
+        uint64_t changeCount {};
+        uint32_t keyframeInterval {};
+        uint32_t keyframeCount {};
+    };
+
+    // drops the current movie; the first frame starts at the machine's current state
+    void startRecording(const Machine& machine, const uint32_t keyframeInterval = defaultKeyframeInterval);
+
+    // called right before the machine runs the frame with these changes
+    void recordFrame(const Machine& machine, const Machine::ButtonChange* changes, const size_t changeCount);
+
+    bool save(const std::string& fileName) const;
+    bool load(const std::string& fileName);
+
+    uint64_t frameCount() const { return mFrameStarts.empty() ? 0 : mFrameStarts.size() - 1; }
+    uint64_t romHash() const { return mRomHash; }
+    uint64_t initialStateHash() const { return mInitialStateHash; }
+
+    // the changes of a recorded frame
+    const Machine::ButtonChange* frameChanges(const uint64_t frame, size_t& changeCount) const;
+
+    // puts the machine at the start of the given frame. Returns false if the movie does not fit the machine
+    bool seek(Machine& machine, const uint64_t frame) const;
+
+private:
+    struct Keyframe
+    {
+        uint64_t frame {};
+        std::vector<uint8_t> state;
+    };
+
+    uint64_t mRomHash {};
+    uint64_t mInitialStateHash {};
+    uint32_t mKeyframeInterval { defaultKeyframeInterval };
+
+    std::vector<Machine::ButtonChange> mChanges;
+    std::vector<uint64_t> mFrameStarts; // index of each frame's first change; one more entry than frames
+    std::vector<Keyframe> mKeyframes;
+};
@@ -0,0 +1,219 @@
+#include "Machine.h"
+
+#include "../SaveState/StateBuffer.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// a frame always completes within this many machine cycles, also while the LCD gets switched on or off
+static constexpr uint32_t gMaxMachineCyclesPerFrame = 2 * cyclesPerFrame / cyclesPerMachineCycle;
+
+// FNV-1a
+static constexpr uint64_t gHashOffset = 0xCBF29CE484222325;
+static constexpr uint64_t gHashPrime = 0x100000001B3;
+
+// runners keep hundreds of machines; anything growing a machine beyond this belongs outside of it.
+// With libstdc++ on x86-64 a machine is 68,704 bytes; tests/MachineTest.cpp prints the size
+static constexpr size_t gMaxMachineSize = 68 * 1024;
+static_assert(sizeof(Machine) <= gMaxMachineSize, "a machine is meant to stay one compact block of state");
+
+Machine::Machine()
+    : mCpuCore(mMemoryManager),
+      mPpu(mMemoryManager)
+{}
+
+std::shared_ptr<const Machine::Rom> Machine::readRom(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) return nullptr;
+
+    auto rom = std::make_shared<Rom>();
+    rom->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    rom->hash = hashBytes(rom->data.data(), rom->data.size());
+    return rom;
+}
+
+bool Machine::loadRom(const std::string& fileName)
+{
+    std::shared_ptr<const Rom> rom = readRom(fileName);
+    if (!rom) return false;
+
+    setRom(std::move(rom));
+    return true;
+}
+
+void Machine::setRom(std::shared_ptr<const Rom> rom)
+{
+    mRom = std::move(rom);
+    mMemoryManager.setCartridgeRom(mRom ? mRom->data.data() : nullptr, mRom ? mRom->data.size() : 0);
+
+    if (mRom && mRom->data.size() > cartridgeColorFlag)
+    {
+        mMemoryManager.setColorMode((mRom->data[cartridgeColorFlag] & 0x80) != 0);
+    }
+}
+
+void Machine::setBootRom(std::shared_ptr<const Rom> bootRom)
+{
+    mBootRom = std::move(bootRom);
+    mMemoryManager.setBootRom(mBootRom ? mBootRom->data.data() : nullptr, mBootRom ? mBootRom->data.size() : 0);
+}
+
+bool Machine::runFrame(const ButtonChange* changes, const size_t changeCount)
+{
+    MemoryManager& memory = mMemoryManager;
+    Apu& apu = mMemoryManager.apu();
+    Ppu& ppu = mPpu;
+
+    // one frame's worth of cycles in one batch; it ends together with the PPU's frame. The batch is only
+    // interrupted where a button changes
+    bool frameDone = false;
+    const auto tick = [&memory, &apu, &ppu, &frameDone]
+    {
+        memory.tick(cyclesPerMachineCycle);
+        apu.tick(cyclesPerMachineCycle);
+        frameDone = ppu.tick(cyclesPerMachineCycle);
+        return frameDone;
+    };
+
+    uint32_t machineCycle = 0;
+    for (size_t index = 0; index < changeCount; index++)
+    {
+        const ButtonChange& change = changes[index];
+        if (frameDone == false && change.machineCycle > machineCycle)
+        {
+            machineCycle += mCpuCore.runMachineCycles(change.machineCycle - machineCycle, tick);
+        }
+
+        mMemoryManager.setJoypadButtons(change.buttons);
+    }
+
+    if (frameDone == false)
+    {
+        mCpuCore.runMachineCycles(gMaxMachineCyclesPerFrame - machineCycle, tick);
+    }
+
+    return frameDone;
+}
+
+void Machine::saveState(std::vector<uint8_t>& buffer) const
+{
+    StateWriter writer(buffer);
+
+    StateHeader header {};
+    header.magic = stateMagic;
+    header.version = stateVersion;
+    header.headerSize = sizeof(StateHeader);
+    header.romHash = romHash();
+    writer.write(header);
+
+    mCpuCore.saveState(writer);
+    mMemoryManager.saveState(writer);
+    mPpu.saveState(writer);
+
+    // the payload size and the layout are only known now
+    header.payloadSize = static_cast<uint32_t>(writer.size() - sizeof(StateHeader));
+    header.layout = writer.layout();
+    std::memcpy(buffer.data(), &header, sizeof(StateHeader));
+}
+
+bool Machine::loadState(const uint8_t* data, const size_t size)
+{
+    StateReader reader(data, size);
+
+    StateHeader header {};
+    reader.read(header);
+    if (reader.failed()
+        || header.magic != stateMagic
+        || header.version != stateVersion
+        || header.headerSize != sizeof(StateHeader)
+        || header.romHash != romHash()
+        || header.payloadSize != reader.remaining())
+    {
+        return false;
+    }
+
+    // the payload can still turn out broken halfway through, or to have been written with other fields; the
+    // machine then goes back to where it was
+    saveState(mRollbackState);
+    if (loadPayload(reader) && reader.layout() == header.layout) return true;
+
+    StateReader rollback(mRollbackState.data() + sizeof(StateHeader), mRollbackState.size() - sizeof(StateHeader));
+    loadPayload(rollback);
+    return false;
+}
+
+void Machine::reset()
+{
+    // the post-boot state differs between the modes (palettes, banks), so there is one per mode; only the
+    // payload is needed. The colour mode is part of it, so loading it keeps the mode
+    const auto capture = [](const bool colorMode)
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->mMemoryManager.setColorMode(colorMode);
+        machine->mMemoryManager.resetMemory();
+
+        std::vector<uint8_t> state;
+        machine->saveState(state);
+        return state;
+    };
+    static const std::vector<uint8_t> monochromeState = capture(false);
+    static const std::vector<uint8_t> colorState = capture(true);
+
+    const std::vector<uint8_t>& postBootState = mMemoryManager.colorMode() ? colorState : monochromeState;
+    StateReader reader(postBootState.data() + sizeof(StateHeader), postBootState.size() - sizeof(StateHeader));
+    loadPayload(reader);
+
+    if (mBootRom)
+    {
+        mMemoryManager.resetMemory();
+        mCpuCore.reset(true);
+    }
+}
+
+bool Machine::loadPayload(StateReader& reader)
+{
+    mCpuCore.loadState(reader);
+    mMemoryManager.loadState(reader);
+    mPpu.loadState(reader);
+
+    return reader.failed() == false && reader.remaining() == 0;
+}
+
+void Machine::forkFrom(const Machine& parent)
+{
+    mRom = parent.mRom;
+    mBootRom = parent.mBootRom;
+
+    // the CPU and PPU state is a few dozen bytes
+    StateWriter writer(mForkBuffer);
+    parent.mCpuCore.saveState(writer);
+    parent.mPpu.saveState(writer);
+
+    StateReader reader(mForkBuffer.data(), mForkBuffer.size());
+    mCpuCore.loadState(reader);
+    mPpu.loadState(reader);
+
+    // the shared memory brings no write stamps along
+    mMemoryManager.forkFrom(parent.mMemoryManager);
+    mPpu.invalidateLines();
+}
+
+std::unique_ptr<Machine> Machine::fork() const
+{
+    auto child = std::make_unique<Machine>();
+    child->forkFrom(*this);
+    return child;
+}
+
+uint64_t Machine::hashBytes(const uint8_t* data, const size_t size)
+{
+    uint64_t hash = gHashOffset;
+    for (size_t index = 0; index < size; index++)
+    {
+        hash = (hash ^ data[index]) * gHashPrime;
+    }
+
+    return hash;
+}
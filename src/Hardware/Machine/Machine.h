@@ -0,0 +1,124 @@
+#pragma once
+
+#include "../CPU/CpuCore/CpuCore.h"
+#include "../Memory/MemoryManager.h"
+#include "../PPU/Ppu.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class StateReader;
+
+/*  @ingroup Machine
+
+    one complete GBC: the CPU with the memory and all peripherals, emulated frame by frame.
+    Save states are one contiguous buffer: a fixed header followed by the state of every component. The ROM is
+    not part of a state, only its hash, and a state is only loaded into a machine running the same ROM.
+    Caches (video write stamps, the PPU's line versions) are not saved either; they are rebuilt after loading.
+    All state lives inside the object, so a machine is a single allocation of sizeof(Machine), 67 KB for
+    GBC (48 KB of it video and work RAM), and running it allocates nothing. Only three things live elsewhere:
+    the ROM, shared; the sample buffers, allocated when sound synthesis is first enabled; and the frozen RAM
+    pages and the buffers that forking and loading use.
+*/
+
+class Machine
+{
+public:
+    Machine();
+    ~Machine() = default;
+
+    // bump whenever a component changes what it saves. Forgetting to is caught by the layout fingerprint, which
+    // only changes with the fields themselves (see StateWriter)
+    static constexpr uint32_t stateMagic = 0x53474342; // "BCGS"
+    static constexpr uint16_t stateVersion = 4;
+
+    struct StateHeader
+    {
+        uint32_t magic {};
+        uint16_t version {};
+        uint16_t headerSize {};
+        uint64_t romHash {};
+        uint32_t payloadSize {};
+        uint32_t layout {};
+    };
+
+    // a change of the pressed buttons (see Joypad::Button) at a machine cycle of the frame
+    struct ButtonChange
+    {
+        uint32_t machineCycle {};
+        uint8_t buttons {};
+    };
+
+    // the cartridge contents; read-only once loaded, so any amount of machines can share one
+    struct Rom
+    {
+        std::vector<uint8_t> data;
+        uint64_t hash {};
+    };
+
+    // reads the whole ROM file; returns nullptr if it cannot be read
+    static std::shared_ptr<const Rom> readRom(const std::string& fileName);
+
+    // returns false if the file cannot be read. The colour mode follows the cartridge header
+    bool loadRom(const std::string& fileName);
+    void setRom(std::shared_ptr<const Rom> rom);
+    uint64_t romHash() const { return mRom ? mRom->hash : 0; }
+
+    /*  with a boot ROM (see MemoryManager::setBootRom), every reset powers the machine on and runs it. Without
+        one, the default, a reset skips straight to the post-boot state, which saves the few hundred thousand
+        cycles the boot animation takes. Takes effect with the next reset
+    */
+    void setBootRom(std::shared_ptr<const Rom> bootRom);
+
+    /*  runs until the PPU completes a frame. The changes have to be sorted by machine cycle; those the frame
+        does not reach are applied at its end. Returns false if no frame was completed
+    */
+    bool runFrame(const ButtonChange* changes = nullptr, const size_t changeCount = 0);
+
+    // the buffer keeps its capacity, so saving into the same buffer again allocates nothing
+    void saveState(std::vector<uint8_t>& buffer) const;
+
+    // returns false if the state was written by another version or for another ROM, or turns out broken while
+    // loading. The machine is left as it was then
+    bool loadState(const uint8_t* data, const size_t size);
+
+    /*  puts the machine back into the state right after the boot ROM, the one a new machine starts in. That
+        state is captured once per process for each colour mode and loaded from there, so a reset costs one
+        copy of the RAM. The ROM, the colour mode and the settings (display buffer, colour conversion, frame
+        skipping, sound synthesis) are kept.
+        With a boot ROM set, the machine is powered on with the boot ROM mapped instead
+    */
+    void reset();
+
+    /*  turns this machine into a copy of parent, e.g. to branch a search. Video and work RAM are shared
+        copy-on-write, only the CPU and peripheral state gets copied. The copy keeps its own display buffer
+        (none for a new machine) and has sound synthesis disabled. Neither machine may run meanwhile
+    */
+    void forkFrom(const Machine& parent);
+    std::unique_ptr<Machine> fork() const;
+
+    MemoryManager& memory() { return mMemoryManager; }
+    CpuCore& cpu() { return mCpuCore; }
+    Ppu& ppu() { return mPpu; }
+    Apu& apu() { return mMemoryManager.apu(); }
+
+    // FNV-1a; identifies ROMs and states
+    static uint64_t hashBytes(const uint8_t* data, const size_t size);
+
+private:
+    // the state behind the header
+    bool loadPayload(StateReader& reader);
+
+    MemoryManager mMemoryManager;
+    CpuCore mCpuCore;
+    Ppu mPpu;
+
+    std::shared_ptr<const Rom> mRom; // shared with forks and other machines
+    std::shared_ptr<const Rom> mBootRom;
+
+    std::vector<uint8_t> mForkBuffer;
+    std::vector<uint8_t> mRollbackState; // the state before a load, in case the load fails
+};
@@ -5,6 +5,14 @@
 static constexpr uint16_t bootRomByte = 0xFF50;
 
 static constexpr uint16_t cartridgetRomStart = 0x0100;
+static constexpr uint16_t cartridgeColorFlag = 0x0143; // bit 7 set: the game supports the GBC
+
+// the ROM area is mapped in pages of this size, so the boot ROM can cover parts of it
+static constexpr uint16_t romPageSize = 0x0100;
+
+// the DMG boot ROM covers 0x0000 - 0x00FF; the GBC one also 0x0200 - 0x08FF, with the cartridge header visible in between
+static constexpr uint16_t bootRomSize = 0x0100;
+static constexpr uint16_t colorBootRomSize = 0x0900;
 
 static constexpr uint16_t romBankSize = 0x4000;
 static constexpr uint8_t romBankCount = 128;
@@ -13,4 +21,99 @@ static constexpr uint16_t ramBankSize = 0x2000;
 static constexpr uint8_t ramBankCount = 4;
 
 static constexpr uint16_t vRamMemoryStart = 0x8000;
-static constexpr uint16_t vRamMemoryEnd = 0x97FF;
\ No newline at end of file
+static constexpr uint16_t vRamMemoryEnd = 0x97FF;
+
+// video RAM: 0x8000 - 0x97FF tile data, 0x9800 - 0x9FFF the two 32x32 tile maps. GBC has two banks
+static constexpr uint16_t vRamBankSize = 0x2000;
+static constexpr uint8_t vRamBankCount = 2;
+static constexpr uint16_t tileMapMemoryStart = 0x9800;
+static constexpr uint16_t tileMapMemoryEnd = 0x9FFF;
+static constexpr uint16_t tileMapSize = 0x0400;
+static constexpr uint16_t tileSize = 16;
+static constexpr uint16_t tilesPerBank = (tileMapMemoryStart - vRamMemoryStart) / tileSize;
+
+static constexpr uint16_t cartridgeRamStart = 0xA000;
+
+// work RAM: bank 0 is fixed, 0xD000 - 0xDFFF switches between banks 1-7 on GBC
+static constexpr uint16_t wRamMemoryStart = 0xC000;
+static constexpr uint16_t wRamSwitchableStart = 0xD000;
+static constexpr uint16_t echoRamStart = 0xE000;
+static constexpr uint16_t wRamBankSize = 0x1000;
+static constexpr uint8_t wRamBankCount = 8;
+
+// object attribute memory: 40 objects of 4 bytes each
+static constexpr uint16_t oamMemoryStart = 0xFE00;
+static constexpr uint16_t oamMemoryEnd = 0xFE9F;
+static constexpr uint8_t oamObjectCount = 40;
+static constexpr uint8_t oamObjectSize = 4;
+
+static constexpr uint16_t ioRegistersStart = 0xFF00;
+static constexpr uint16_t highRamStart = 0xFF80;
+static constexpr uint16_t interruptEnableRegister = 0xFFFF;
+
+// I/O registers
+static constexpr uint16_t joypadRegister = 0xFF00;
+static constexpr uint16_t serialControlRegister = 0xFF02;
+static constexpr uint16_t dividerRegister = 0xFF04;
+static constexpr uint16_t timerCounterRegister = 0xFF05;
+static constexpr uint16_t timerModuloRegister = 0xFF06;
+static constexpr uint16_t timerControlRegister = 0xFF07;
+static constexpr uint16_t interruptFlagRegister = 0xFF0F;
+
+// sound registers (NR10 - NR52) and wave RAM
+static constexpr uint16_t audioRegistersStart = 0xFF10;
+static constexpr uint16_t audioRegistersEnd = 0xFF3F;
+static constexpr uint16_t channel1SweepRegister = 0xFF10;
+static constexpr uint16_t channel1LengthRegister = 0xFF11;
+static constexpr uint16_t channel1EnvelopeRegister = 0xFF12;
+static constexpr uint16_t channel1FrequencyRegister = 0xFF13;
+static constexpr uint16_t channel1ControlRegister = 0xFF14;
+static constexpr uint16_t channel2LengthRegister = 0xFF16;
+static constexpr uint16_t channel2EnvelopeRegister = 0xFF17;
+static constexpr uint16_t channel2FrequencyRegister = 0xFF18;
+static constexpr uint16_t channel2ControlRegister = 0xFF19;
+static constexpr uint16_t channel3DacRegister = 0xFF1A;
+static constexpr uint16_t channel3LengthRegister = 0xFF1B;
+static constexpr uint16_t channel3VolumeRegister = 0xFF1C;
+static constexpr uint16_t channel3FrequencyRegister = 0xFF1D;
+static constexpr uint16_t channel3ControlRegister = 0xFF1E;
+static constexpr uint16_t channel4LengthRegister = 0xFF20;
+static constexpr uint16_t channel4EnvelopeRegister = 0xFF21;
+static constexpr uint16_t channel4PolynomialRegister = 0xFF22;
+static constexpr uint16_t channel4ControlRegister = 0xFF23;
+static constexpr uint16_t masterVolumeRegister = 0xFF24;
+static constexpr uint16_t soundPanningRegister = 0xFF25;
+static constexpr uint16_t soundControlRegister = 0xFF26;
+static constexpr uint16_t waveRamStart = 0xFF30;
+
+static constexpr uint16_t lcdControlRegister = 0xFF40;
+static constexpr uint16_t lcdStatusRegister = 0xFF41;
+static constexpr uint16_t scrollYRegister = 0xFF42;
+static constexpr uint16_t scrollXRegister = 0xFF43;
+static constexpr uint16_t lcdYCoordinateRegister = 0xFF44;
+static constexpr uint16_t lcdYCompareRegister = 0xFF45;
+static constexpr uint16_t oamDmaRegister = 0xFF46;
+static constexpr uint16_t backgroundPaletteRegister = 0xFF47;
+static constexpr uint16_t objectPalette0Register = 0xFF48;
+static constexpr uint16_t objectPalette1Register = 0xFF49;
+static constexpr uint16_t windowYRegister = 0xFF4A;
+static constexpr uint16_t windowXRegister = 0xFF4B;
+static constexpr uint16_t vRamBankRegister = 0xFF4F;
+static constexpr uint16_t backgroundPaletteSpecRegister = 0xFF68;
+static constexpr uint16_t backgroundPaletteDataRegister = 0xFF69;
+static constexpr uint16_t objectPaletteSpecRegister = 0xFF6A;
+static constexpr uint16_t objectPaletteDataRegister = 0xFF6B;
+static constexpr uint16_t wRamBankRegister = 0xFF70;
+
+// bit positions in the IF and IE registers; the lowest bit has the highest priority
+static constexpr uint8_t interruptSourceMask = 0b00011111;
+static constexpr uint16_t interruptVectorStart = 0x0040; // one vector every 8 bytes, in bit order
+
+enum class InterruptType : uint8_t
+{
+    vertical_blank = 0,
+    lcd_status = 1,
+    timer = 2,
+    serial = 3,
+    joypad = 4
+};
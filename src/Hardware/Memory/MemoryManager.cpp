@@ -1,27 +1,591 @@
 #include "MemoryManager.h"
 
-#include "MemoryDefines.h"
+#include "../SaveState/StateBuffer.h"
+
+#include <array>
+#include <cstring>
+#include <utility>
+
+/*  the I/O registers as the GBC boot ROM leaves them for a colour game. Registers that are not listed read 0.
+    The boot sound has ended by then; the APU stays powered with full volume on both outputs
+*/
+static constexpr std::array<std::pair<uint16_t, uint8_t>, 9> gPostBootIoRegisters
+{{
+    { joypadRegister, 0xCF },
+    { serialControlRegister, 0x7F },
+    { interruptFlagRegister, 0xE1 },
+    { lcdControlRegister, 0x91 },
+    { lcdStatusRegister, 0x81 },
+    { backgroundPaletteRegister, 0xFC },
+    { vRamBankRegister, 0xFE },
+    { bootRomByte, 0x11 }, // the boot ROM unmaps itself by writing A
+    { wRamBankRegister, 0xF8 }
+}};
+
+// what the CPU reads where nothing is mapped
+static const std::array<uint8_t, romPageSize> gOpenBusPage = []
+{
+    std::array<uint8_t, romPageSize> page;
+    page.fill(0xFF);
+    return page;
+}();
+
+// the GBC boot ROM sets all background colours to white; object colours are left undefined
+static constexpr uint8_t gPostBootBackgroundColorLow = 0xFF;
+static constexpr uint8_t gPostBootBackgroundColorHigh = 0x7F;
+static constexpr uint8_t gPaletteAutoIncrement = 0x80;
+
+static constexpr std::array<std::pair<uint16_t, uint8_t>, 3> gPostBootAudioRegisters
+{{
+    { soundControlRegister, 0x80 }, // power first; the other registers ignore writes while the APU is off
+    { masterVolumeRegister, 0x77 },
+    { soundPanningRegister, 0xF3 }
+}};
 
 MemoryManager::MemoryManager()
 {
+    resetMemory();
 }
 
 MemoryManager::~MemoryManager()
 {}
 
-uint8_t MemoryManager::getMemoryAtAddress(uint16_t address) const
+uint8_t MemoryManager::getMemoryAtAddress(uint16_t address)
 {
-    return mWorkRam.at(address);
+    if (address < vRamMemoryStart)
+    {
+        return mRomPages[address / romPageSize][address % romPageSize];
+    }
+    if (address < cartridgeRamStart)
+    {
+        return mVideoRam.read(mVideoRamBank * vRamBankSize + (address - vRamMemoryStart));
+    }
+    if (address < wRamMemoryStart) // TODO cartridge RAM
+    {
+        return 0xFF;
+    }
+    if (address < oamMemoryStart)
+    {
+        // 0xE000 - 0xFDFF mirrors work RAM
+        if (address >= echoRamStart) address -= (echoRamStart - wRamMemoryStart);
+
+        if (address < wRamSwitchableStart) return mWorkRam.read(address - wRamMemoryStart);
+        return mWorkRam.read(mWorkRamBank * wRamBankSize + (address - wRamSwitchableStart));
+    }
+    if (address <= oamMemoryEnd)
+    {
+        return mOam[address - oamMemoryStart];
+    }
+    if (address < ioRegistersStart) // unusable area
+    {
+        return 0xFF;
+    }
+    if (address < highRamStart)
+    {
+        if (address >= audioRegistersStart && address <= audioRegistersEnd) return mApu.readRegister(address);
+        if (address >= dividerRegister && address <= timerControlRegister)
+        {
+            runEvents();
+            return mTimer.readRegister(address, mClock);
+        }
+
+        switch (address)
+        {
+            case joypadRegister: return mJoypad.read();
+            case backgroundPaletteSpecRegister: return mPaletteMemory.specification(false);
+            case backgroundPaletteDataRegister: return mPaletteMemory.data(false);
+            case objectPaletteSpecRegister: return mPaletteMemory.specification(true);
+            case objectPaletteDataRegister: return mPaletteMemory.data(true);
+            default: return mIoRegisters[address - ioRegistersStart];
+        }
+    }
+    if (address < interruptEnableRegister)
+    {
+        return mHighRam[address - highRamStart];
+    }
+
+    return mInterruptEnable;
 }
 
 void MemoryManager::writeToMemoryAddress(const uint16_t address, const uint8_t value)
 {
-    mWorkRam.at(address) = value;
+    if (address < vRamMemoryStart) // TODO cartridge ROM / MBC registers
+    {
+        return;
+    }
+    if (address < cartridgeRamStart)
+    {
+        writeVideoRam(address, value);
+        return;
+    }
+    if (address < wRamMemoryStart) // TODO cartridge RAM
+    {
+        return;
+    }
+    if (address < oamMemoryStart)
+    {
+        const uint16_t wRamAddress = (address >= echoRamStart) ? address - (echoRamStart - wRamMemoryStart) : address;
+
+        if (wRamAddress < wRamSwitchableStart)
+        {
+            mWorkRam.write(wRamAddress - wRamMemoryStart, value);
+        }
+        else
+        {
+            mWorkRam.write(mWorkRamBank * wRamBankSize + (wRamAddress - wRamSwitchableStart), value);
+        }
+        return;
+    }
+    if (address <= oamMemoryEnd)
+    {
+        writeOam(static_cast<uint8_t>(address - oamMemoryStart), value);
+        return;
+    }
+    if (address < ioRegistersStart) // unusable area
+    {
+        return;
+    }
+    if (address < highRamStart)
+    {
+        if (address >= audioRegistersStart && address <= audioRegistersEnd)
+        {
+            mApu.writeRegister(address, value);
+            return;
+        }
+        if (address >= dividerRegister && address <= timerControlRegister)
+        {
+            if (mTimer.writeRegister(address, value, mClock)) requestInterrupt(InterruptType::timer);
+            mNextEventCycle = mTimer.nextEvent();
+            return;
+        }
+
+        writeIoRegister(address, value);
+        return;
+    }
+    if (address < interruptEnableRegister)
+    {
+        mHighRam[address - highRamStart] = value;
+        return;
+    }
+
+    mInterruptEnable = value;
+}
+
+uint8_t MemoryManager::ioRegister(const uint16_t address) const
+{
+    return mIoRegisters[address - ioRegistersStart];
+}
+
+void MemoryManager::setIoRegister(const uint16_t address, const uint8_t value)
+{
+    mIoRegisters[address - ioRegistersStart] = value;
+}
+
+uint8_t MemoryManager::videoRamAt(const uint8_t bank, const uint16_t address) const
+{
+    return mVideoRam.read(bank * vRamBankSize + (address - vRamMemoryStart));
+}
+
+uint8_t MemoryManager::oamAt(const uint8_t offset) const
+{
+    return mOam[offset];
+}
+
+void MemoryManager::runEvents()
+{
+    if (mTimer.update(mClock)) requestInterrupt(InterruptType::timer);
+    mNextEventCycle = mTimer.nextEvent();
+}
+
+void MemoryManager::requestInterrupt(const InterruptType interrupt)
+{
+    mIoRegisters[interruptFlagRegister - ioRegistersStart] |= (1 << static_cast<uint8_t>(interrupt));
+}
+
+void MemoryManager::acknowledgeInterrupt(const uint8_t bit)
+{
+    mIoRegisters[interruptFlagRegister - ioRegistersStart] &= ~(1 << bit);
+}
+
+const MemoryManager::VideoWriteVersions& MemoryManager::videoWriteVersions() const
+{
+    return mVideoWriteVersions;
+}
+
+const PaletteMemory& MemoryManager::paletteMemory() const
+{
+    return mPaletteMemory;
+}
+
+Apu& MemoryManager::apu()
+{
+    return mApu;
+}
+
+void MemoryManager::setJoypadButtons(const uint8_t buttons)
+{
+    if (mJoypad.setButtons(buttons)) requestInterrupt(InterruptType::joypad);
+}
+
+const Joypad& MemoryManager::joypad() const
+{
+    return mJoypad;
+}
+
+void MemoryManager::setColorConversion(const ColorTable::PixelFormat format, const ColorTable::ColorCorrection correction)
+{
+    mPaletteMemory.setColorConversion(format, correction);
+    mVideoWriteVersions.colorConversion = ++mVideoWriteVersions.writeCounter;
+}
+
+bool MemoryManager::colorMode() const
+{
+    return mColorMode;
+}
+
+void MemoryManager::setColorMode(const bool colorMode)
+{
+    mColorMode = colorMode;
+    if (mColorMode == false)
+    {
+        mVideoRamBank = 0;
+        mWorkRamBank = 1;
+    }
+}
+
+void MemoryManager::writeVideoRam(const uint16_t address, const uint8_t value)
+{
+    const uint16_t offset = address - vRamMemoryStart;
+    const uint32_t ramAddress = mVideoRamBank * vRamBankSize + offset;
+
+    // games rewrite unchanged data all the time; only real changes invalidate rendered lines (or copy a shared page)
+    if (mVideoRam.read(ramAddress) == value) return;
+    mVideoRam.write(ramAddress, value);
+
+    const uint64_t stamp = ++mVideoWriteVersions.writeCounter;
+    if (address < tileMapMemoryStart)
+    {
+        mVideoWriteVersions.tileData[mVideoRamBank * tilesPerBank + offset / tileSize] = stamp;
+    }
+    else
+    {
+        // 32 entries per map row, 32 rows per map
+        const uint16_t mapRow = (address - tileMapMemoryStart) / 32;
+        mVideoWriteVersions.tileMapRows[mVideoRamBank * 64 + mapRow] = stamp;
+    }
+}
+
+void MemoryManager::writeOam(const uint8_t offset, const uint8_t value)
+{
+    uint8_t& target = mOam[offset];
+    if (target == value) return;
+    target = value;
+
+    mVideoWriteVersions.objects[offset / oamObjectSize] = ++mVideoWriteVersions.writeCounter;
+}
+
+void MemoryManager::writeIoRegister(const uint16_t address, const uint8_t value)
+{
+    uint8_t& target = mIoRegisters[address - ioRegistersStart];
+
+    switch (address)
+    {
+        case joypadRegister:
+        {
+            if (mJoypad.writeSelection(value)) requestInterrupt(InterruptType::joypad);
+            return;
+        }
+        case interruptFlagRegister:
+        {
+            // the upper three bits do not exist and read as 1
+            target = value | static_cast<uint8_t>(~interruptSourceMask);
+            return;
+        }
+        case lcdStatusRegister:
+        {
+            // only the interrupt selection bits are writable
+            target = (target & 0b10000111) | (value & 0b01111000);
+            return;
+        }
+        case lcdYCoordinateRegister:
+        {
+            // read-only
+            return;
+        }
+        case bootRomByte:
+        {
+            // only the first non-zero write counts; the boot ROM cannot be mapped back in
+            if (target != 0 || value == 0) return;
+
+            target = value;
+            updateRomPages();
+            return;
+        }
+        case oamDmaRegister:
+        {
+            target = value;
+            performOamDma(value);
+            return;
+        }
+        case vRamBankRegister:
+        {
+            if (mColorMode == false) return;
+
+            mVideoRamBank = value & 0b1;
+            target = 0b11111110 | mVideoRamBank;
+            return;
+        }
+        case wRamBankRegister:
+        {
+            if (mColorMode == false) return;
+
+            // bank 0 cannot be mapped into the switchable area
+            mWorkRamBank = (value & 0b111) == 0 ? 1 : (value & 0b111);
+            target = 0b11111000 | (value & 0b111);
+            return;
+        }
+        case backgroundPaletteSpecRegister:
+        case objectPaletteSpecRegister:
+        {
+            mPaletteMemory.setSpecification(address == objectPaletteSpecRegister, value);
+            return;
+        }
+        case backgroundPaletteDataRegister:
+        case objectPaletteDataRegister:
+        {
+            const uint8_t palette = mPaletteMemory.writeData(address == objectPaletteDataRegister, value);
+            if (palette != PaletteMemory::noPaletteChanged)
+            {
+                mVideoWriteVersions.palettes[palette] = ++mVideoWriteVersions.writeCounter;
+            }
+            return;
+        }
+        default:
+        {
+            target = value;
+            return;
+        }
+    }
+}
+
+void MemoryManager::performOamDma(const uint8_t sourceHighByte)
+{
+    // TODO the transfer takes 160 machine cycles on hardware; it is performed instantly here
+    const uint16_t sourceAddress = sourceHighByte << 8;
+    for (uint8_t offset = 0; offset < oamObjectCount * oamObjectSize; offset++)
+    {
+        writeOam(offset, getMemoryAtAddress(sourceAddress + offset));
+    }
+}
+
+void MemoryManager::setCartridgeRom(const uint8_t* data, const size_t size)
+{
+    mCartridgeRom = data;
+    mCartridgeRomSize = data ? size : 0;
+    updateRomPages();
+}
+
+void MemoryManager::setBootRom(const uint8_t* data, const size_t size)
+{
+    mBootRom = data;
+    mBootRomSize = data ? size : 0;
+    updateRomPages();
+}
+
+bool MemoryManager::bootRomMapped() const
+{
+    return mBootRom && mIoRegisters[bootRomByte - ioRegistersStart] == 0;
 }
 
 void MemoryManager::resetMemory()
 {
-    //  BOOT_OFF
-    mWorkRam.at(bootRomByte) = 0;
-    
-}
\ No newline at end of file
+    mVideoRam.clear();
+    mWorkRam.clear();
+    mHighRam.fill(0);
+    mOam.fill(0);
+    mIoRegisters.fill(0);
+
+    mInterruptEnable = 0;
+    mVideoRamBank = 0;
+    mWorkRamBank = 1;
+
+    mClock = 0;
+    mNextEventCycle = Timer::noEvent;
+
+    mPaletteMemory.reset();
+    mApu.reset();
+    mJoypad.reset();
+    mTimer.reset(mClock);
+
+    // everything the PPU may have drawn from is gone
+    const uint64_t stamp = ++mVideoWriteVersions.writeCounter;
+    mVideoWriteVersions.tileData.fill(stamp);
+    mVideoWriteVersions.tileMapRows.fill(stamp);
+    mVideoWriteVersions.objects.fill(stamp);
+    mVideoWriteVersions.palettes.fill(stamp);
+
+    // the boot ROM sets up everything else itself
+    if (mBootRom == nullptr) setPostBootState();
+
+    updateRomPages();
+}
+
+void MemoryManager::setPostBootState()
+{
+    for (const auto& [address, value] : gPostBootIoRegisters)
+    {
+        mIoRegisters[address - ioRegistersStart] = value;
+    }
+    for (const auto& [address, value] : gPostBootAudioRegisters)
+    {
+        mApu.writeRegister(address, value);
+    }
+
+    if (mColorMode == false) return;
+
+    // the specification wraps around to the first colour again
+    writeIoRegister(backgroundPaletteSpecRegister, gPaletteAutoIncrement);
+    for (uint8_t color = 0; color < PaletteMemory::paletteCount / 2 * PaletteMemory::colorsPerPalette; color++)
+    {
+        writeIoRegister(backgroundPaletteDataRegister, gPostBootBackgroundColorLow);
+        writeIoRegister(backgroundPaletteDataRegister, gPostBootBackgroundColorHigh);
+    }
+}
+
+void MemoryManager::updateRomPages()
+{
+    const bool bootRom = bootRomMapped();
+
+    for (size_t page = 0; page < mRomPages.size(); page++)
+    {
+        const size_t offset = page * romPageSize;
+
+        // TODO memory bank controllers; bank 1 stays mapped at 0x4000
+        if (bootRom && offset != cartridgetRomStart && offset + romPageSize <= mBootRomSize)
+        {
+            mRomPages[page] = mBootRom + offset;
+        }
+        else if (offset + romPageSize <= mCartridgeRomSize)
+        {
+            mRomPages[page] = mCartridgeRom + offset;
+        }
+        else
+        {
+            mRomPages[page] = gOpenBusPage.data();
+        }
+    }
+}
+
+void MemoryManager::saveState(StateWriter& writer) const
+{
+    writer.writeBytes(mHighRam.data(), mHighRam.size());
+    mVideoRam.saveState(writer);
+    mWorkRam.saveState(writer);
+    writer.writeBytes(mOam.data(), mOam.size());
+    writer.writeBytes(mIoRegisters.data(), mIoRegisters.size());
+
+    writer.write(mInterruptEnable);
+    writer.write(mVideoRamBank);
+    writer.write(mWorkRamBank);
+    writer.write(mColorMode);
+
+    mPaletteMemory.saveState(writer);
+    mApu.saveState(writer);
+    mJoypad.saveState(writer);
+
+    writer.write(mClock);
+    mTimer.saveState(writer);
+}
+
+void MemoryManager::loadState(StateReader& reader)
+{
+    // only what the state changes counts as written, so the lines the PPU drew stay valid across a load
+    const uint64_t stamp = ++mVideoWriteVersions.writeCounter;
+
+    reader.readBytes(mHighRam.data(), mHighRam.size());
+    mVideoRam.loadState(reader, [this, stamp](const uint32_t page, const uint8_t* previous, const uint8_t* loaded)
+    {
+        constexpr uint16_t pageSize = decltype(mVideoRam)::pageSize;
+        const uint8_t bank = page * pageSize / vRamBankSize;
+        const uint16_t pageOffset = page * pageSize % vRamBankSize;
+
+        // a tile is 16 bytes, a map row 32; comparing 16 bytes at a time finds both
+        for (uint16_t index = 0; index < pageSize; index += tileSize)
+        {
+            if (std::memcmp(previous + index, loaded + index, tileSize) == 0) continue;
+
+            const uint16_t offset = pageOffset + index;
+            if (offset < tileMapMemoryStart - vRamMemoryStart)
+            {
+                mVideoWriteVersions.tileData[bank * tilesPerBank + offset / tileSize] = stamp;
+            }
+            else
+            {
+                mVideoWriteVersions.tileMapRows[bank * 64 + (offset - (tileMapMemoryStart - vRamMemoryStart)) / 32] = stamp;
+            }
+        }
+    });
+    mWorkRam.loadState(reader);
+
+    std::array<uint8_t, oamObjectCount * oamObjectSize> oam;
+    reader.readBytes(oam.data(), oam.size());
+    for (uint8_t object = 0; object < oamObjectCount; object++)
+    {
+        if (std::memcmp(&oam[object * oamObjectSize], &mOam[object * oamObjectSize], oamObjectSize) == 0) continue;
+
+        std::memcpy(&mOam[object * oamObjectSize], &oam[object * oamObjectSize], oamObjectSize);
+        mVideoWriteVersions.objects[object] = stamp;
+    }
+
+    reader.readBytes(mIoRegisters.data(), mIoRegisters.size());
+
+    reader.read(mInterruptEnable);
+    reader.read(mVideoRamBank);
+    reader.read(mWorkRamBank);
+    reader.read(mColorMode);
+
+    const uint16_t changedPalettes = mPaletteMemory.loadState(reader);
+    for (uint8_t palette = 0; palette < PaletteMemory::paletteCount; palette++)
+    {
+        if ((changedPalettes >> palette) & 0b1) mVideoWriteVersions.palettes[palette] = stamp;
+    }
+
+    mApu.loadState(reader);
+    mJoypad.loadState(reader);
+
+    reader.read(mClock);
+    mTimer.loadState(reader);
+    mNextEventCycle = mTimer.nextEvent();
+
+    // whether the boot ROM is mapped follows from FF50
+    updateRomPages();
+}
+
+void MemoryManager::forkFrom(const MemoryManager& parent)
+{
+    mVideoRam.shareFrom(parent.mVideoRam);
+    mWorkRam.shareFrom(parent.mWorkRam);
+
+    mHighRam = parent.mHighRam;
+    mOam = parent.mOam;
+    mIoRegisters = parent.mIoRegisters;
+
+    mInterruptEnable = parent.mInterruptEnable;
+    mVideoRamBank = parent.mVideoRamBank;
+    mWorkRamBank = parent.mWorkRamBank;
+    mColorMode = parent.mColorMode;
+
+    mPaletteMemory = parent.mPaletteMemory;
+    mApu.forkFrom(parent.mApu);
+    mJoypad = parent.mJoypad;
+
+    mClock = parent.mClock;
+    mNextEventCycle = parent.mNextEventCycle;
+    mTimer = parent.mTimer;
+
+    mCartridgeRom = parent.mCartridgeRom;
+    mCartridgeRomSize = parent.mCartridgeRomSize;
+    mBootRom = parent.mBootRom;
+    mBootRomSize = parent.mBootRomSize;
+    mRomPages = parent.mRomPages;
+}
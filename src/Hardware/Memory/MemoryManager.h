@@ -1,7 +1,17 @@
 #pragma once
 
+#include "MemoryDefines.h"
+#include "PagedMemory.h"
+#include "../APU/Apu.h"
+#include "../Joypad/Joypad.h"
+#include "../PPU/PaletteMemory.h"
+#include "../Timer/Timer.h"
+
+#include <array>
 #include <cstdint>
-#include <vector>
+
+class StateReader;
+class StateWriter;
 
 class MemoryManager
 {
@@ -9,13 +19,138 @@ public:
     MemoryManager();
     ~MemoryManager();
 
-    uint8_t getMemoryAtAddress(const uint16_t address) const;
+    /*  write stamps of everything the PPU reads while drawing a line.
+        Every write that actually changes a value takes the next stamp from writeCounter,
+        so the PPU can tell whether an input of a line changed after that line was last drawn.
+    */
+    struct VideoWriteVersions
+    {
+        uint64_t writeCounter {};
+
+        std::array<uint64_t, tilesPerBank * vRamBankCount> tileData {};
+        std::array<uint64_t, 2 * 32 * vRamBankCount> tileMapRows {}; // [bank][map][row]; bank 1 holds the GBC map attributes
+        std::array<uint64_t, oamObjectCount> objects {};
+        std::array<uint64_t, PaletteMemory::paletteCount> palettes {};
+
+        uint64_t colorConversion {};
+    };
+
+    // not const; some registers (e.g. the sound status) have to catch up with the emulation when read
+    uint8_t getMemoryAtAddress(const uint16_t address);
     void writeToMemoryAddress(const uint16_t address, const uint8_t value);
 
+    /*  advances the machine clock by the given amount of T-cycles and runs the peripheral events that became due
+        (so far the timer overflow). Comparing against the next event is all the work done per cycle; the
+        peripherals catch up with the clock when they are accessed
+    */
+    void tick(const uint16_t cycles)
+    {
+        mClock += cycles;
+        if (mClock >= mNextEventCycle) runEvents();
+    }
+
+    // T-cycles since power-on
+    uint64_t clock() const { return mClock; }
+
+    // direct access for the peripherals; no CPU side effects
+    uint8_t ioRegister(const uint16_t address) const;
+    void setIoRegister(const uint16_t address, const uint8_t value);
+
+    uint8_t videoRamAt(const uint8_t bank, const uint16_t address) const;
+    uint8_t oamAt(const uint8_t offset) const;
+
+    void requestInterrupt(const InterruptType interrupt);
+
+    // the interrupts that are requested and enabled (IF & IE), one bit per InterruptType
+    uint8_t pendingInterrupts() const
+    {
+        return mIoRegisters[interruptFlagRegister - ioRegistersStart] & mInterruptEnable & interruptSourceMask;
+    }
+
+    // clears the request once the CPU dispatches it
+    void acknowledgeInterrupt(const uint8_t bit);
+
+    const VideoWriteVersions& videoWriteVersions() const;
+    const PaletteMemory& paletteMemory() const;
+
+    // the sound registers live in the APU
+    Apu& apu();
+
+    // requests the joypad interrupt if a selected button got pressed
+    void setJoypadButtons(const uint8_t buttons);
+    const Joypad& joypad() const;
+
+    void setColorConversion(const ColorTable::PixelFormat format, const ColorTable::ColorCorrection correction);
+
+    // GBC features (VRAM/WRAM banking, colour palettes) are only available in colour mode
+    bool colorMode() const;
+    void setColorMode(const bool colorMode);
+
+    /*  the cartridge ROM, mapped into 0x0000 - 0x7FFF through a table of pages. Without a memory bank controller
+        the first two banks are mapped fixed. The data is owned by the caller and has to outlive the mapping;
+        nullptr unmaps it, reads then return 0xFF
+    */
+    void setCartridgeRom(const uint8_t* data, const size_t size);
+
+    /*  a DMG or GBC boot ROM (bootRomSize or colorBootRomSize bytes), owned by the caller like the cartridge ROM.
+        While mapped, its pages cover those of the cartridge except the header; the first non-zero write to
+        FF50 unmaps it until the next reset
+    */
+    void setBootRom(const uint8_t* data, const size_t size);
+    bool bootRomMapped() const;
+
+    /*  clears all RAM. With a boot ROM, the I/O registers get their power-on values and the boot ROM is mapped;
+        otherwise the I/O registers, the palettes and the APU get the values the boot ROM leaves behind. The
+        colour mode is kept
+    */
     void resetMemory();
 
+    // includes the APU, the joypad, the timer and the palette memory. The write stamps are a cache of the PPU and not saved
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+    // becomes a copy of parent; video and work RAM are shared copy-on-write. The APU of the copy stays silent
+    void forkFrom(const MemoryManager& parent);
+
+    // shared pages of video and work RAM that writes copied back, since the memory was created
+    uint64_t copiedPages() const { return mVideoRam.copiedPages() + mWorkRam.copiedPages(); }
+
 protected:
-    std::vector<uint8_t> mHighRam; // 127 B of RAM, directly connected to the CPU
-    std::vector<uint8_t> mVideoRam; // 16 KB, directly connected to the CPU (for GBC)
-    std::vector<uint8_t> mWorkRam; // 32 KB
+    void writeVideoRam(const uint16_t address, const uint8_t value);
+    void writeOam(const uint8_t offset, const uint8_t value);
+    void writeIoRegister(const uint16_t address, const uint8_t value);
+
+    void performOamDma(const uint8_t sourceHighByte);
+
+    void runEvents();
+
+    // points every ROM page at the boot ROM, the cartridge or open bus
+    void updateRomPages();
+    void setPostBootState();
+
+    std::array<const uint8_t*, vRamMemoryStart / romPageSize> mRomPages {};
+    const uint8_t* mCartridgeRom {};
+    size_t mCartridgeRomSize {};
+    const uint8_t* mBootRom {};
+    size_t mBootRomSize {};
+
+    std::array<uint8_t, interruptEnableRegister - highRamStart> mHighRam {}; // 127 B of RAM, directly connected to the CPU
+    PagedMemory<vRamBankSize * vRamBankCount> mVideoRam; // 16 KB, directly connected to the CPU (for GBC)
+    PagedMemory<wRamBankSize * wRamBankCount> mWorkRam; // 32 KB
+    std::array<uint8_t, oamObjectCount * oamObjectSize> mOam {}; // 160 B of object attributes
+    std::array<uint8_t, highRamStart - ioRegistersStart> mIoRegisters {}; // 128 B, 0xFF00 - 0xFF7F
+
+    uint8_t mInterruptEnable {};
+    uint8_t mVideoRamBank {};
+    uint8_t mWorkRamBank { 1 };
+    bool mColorMode { true };
+
+    uint64_t mClock {};
+    uint64_t mNextEventCycle { Timer::noEvent };
+
+    PaletteMemory mPaletteMemory;
+    Apu mApu;
+    Joypad mJoypad;
+    Timer mTimer;
+    VideoWriteVersions mVideoWriteVersions {};
 };
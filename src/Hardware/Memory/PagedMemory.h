@@ -0,0 +1,187 @@
+#pragma once
+
+#include "../SaveState/StateBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+/*  @ingroup Memory
+
+    a RAM region of fixed size whose pages can be shared between machines copy-on-write.
+    The memory itself is part of the object, so it lives wherever the machine does. Every page is read through
+    the page table, which points either into that memory or at a frozen page: a reference-counted copy nobody
+    writes to anymore. Sharing freezes the pages written since they were last shared, and only those, then
+    both sides point at the frozen pages. A page moves back into the machine's own memory the first time it
+    gets written. Forking thereby costs the pages changed since the last fork, also for forks of forks.
+    Loading a state only replaces the pages it changes; the others stay shared.
+    The machine forked from must not run meanwhile; forking several machines from it at once is fine.
+*/
+
+template <uint32_t Size>
+class PagedMemory
+{
+public:
+    static constexpr uint8_t pageBits = 8;
+    static constexpr uint16_t pageSize = 1 << pageBits;
+    static constexpr uint32_t pageCount = Size / pageSize;
+
+    static_assert(Size % pageSize == 0, "the size has to be a multiple of the page size");
+
+    PagedMemory()
+    {
+        for (uint32_t page = 0; page < pageCount; page++)
+        {
+            mPageTable[page] = ownPage(page);
+        }
+    }
+
+    ~PagedMemory()
+    {
+        releaseFrozenPages();
+    }
+
+    // the page table points into the object itself
+    PagedMemory(const PagedMemory&) = delete;
+    PagedMemory& operator=(const PagedMemory&) = delete;
+
+    uint8_t read(const uint32_t address) const
+    {
+        return mPageTable[address >> pageBits][address & (pageSize - 1)];
+    }
+
+    void write(const uint32_t address, const uint8_t value)
+    {
+        const uint32_t page = address >> pageBits;
+        if (mPageTable[page] != ownPage(page)) unfreezePage(page);
+
+        mBytes[address] = value;
+    }
+
+    // shares every page of other; the pages other wrote since they were last shared get frozen first
+    void shareFrom(const PagedMemory& other)
+    {
+        // several machines may fork from other at the same time
+        std::lock_guard<std::mutex> lock(other.mShareMutex);
+        for (uint32_t page = 0; page < pageCount; page++)
+        {
+            if (other.mPageTable[page] == other.ownPage(page)) other.freezePage(page);
+
+            // a machine forked from the same parent again mostly shares the same pages still
+            const uint8_t* frozen = other.mPageTable[page];
+            if (mPageTable[page] == frozen) continue;
+
+            if (mPageTable[page] != ownPage(page)) release(mPageTable[page]);
+            frozenPage(frozen)->references.fetch_add(1, std::memory_order_relaxed);
+            mPageTable[page] = frozen;
+        }
+    }
+
+    // zeroes everything and stops sharing
+    void clear()
+    {
+        releaseFrozenPages();
+        mBytes.fill(0);
+    }
+
+    static constexpr size_t size() { return Size; }
+    uint64_t copiedPages() const { return mCopiedPages; }
+
+    void saveState(StateWriter& writer) const
+    {
+        for (uint32_t page = 0; page < pageCount; page++)
+        {
+            writer.writeBytes(mPageTable[page], pageSize);
+        }
+    }
+
+    void loadState(StateReader& reader)
+    {
+        loadState(reader, [](const uint32_t, const uint8_t*, const uint8_t*) {});
+    }
+
+    // calls pageChanged(page, previous bytes, loaded bytes) for every page the state changes; pages it leaves as
+    // they are stay shared
+    template <typename PageChanged>
+    void loadState(StateReader& reader, PageChanged&& pageChanged)
+    {
+        std::array<uint8_t, pageSize> bytes;
+        for (uint32_t page = 0; page < pageCount; page++)
+        {
+            reader.readBytes(bytes.data(), pageSize);
+            if (std::memcmp(mPageTable[page], bytes.data(), pageSize) == 0) continue;
+
+            pageChanged(page, mPageTable[page], bytes.data());
+
+            if (mPageTable[page] != ownPage(page))
+            {
+                release(mPageTable[page]);
+                mPageTable[page] = ownPage(page);
+            }
+            std::memcpy(ownPage(page), bytes.data(), pageSize);
+        }
+    }
+
+private:
+    // the bytes come first, so the page table's pointer is also the page's address
+    struct FrozenPage
+    {
+        std::array<uint8_t, pageSize> bytes;
+        std::atomic<uint32_t> references;
+    };
+
+    uint8_t* ownPage(const uint32_t page) { return &mBytes[page * pageSize]; }
+    const uint8_t* ownPage(const uint32_t page) const { return &mBytes[page * pageSize]; }
+
+    static FrozenPage* frozenPage(const uint8_t* bytes)
+    {
+        return reinterpret_cast<FrozenPage*>(const_cast<uint8_t*>(bytes));
+    }
+
+    static void release(const uint8_t* bytes)
+    {
+        FrozenPage* frozen = frozenPage(bytes);
+        if (frozen->references.fetch_sub(1, std::memory_order_acq_rel) == 1) delete frozen;
+    }
+
+    // this memory keeps reading the page from the frozen copy it holds the first reference of
+    void freezePage(const uint32_t page) const
+    {
+        FrozenPage* frozen = new FrozenPage;
+        std::memcpy(frozen->bytes.data(), ownPage(page), pageSize);
+        frozen->references.store(1, std::memory_order_relaxed);
+
+        mPageTable[page] = frozen->bytes.data();
+    }
+
+    void unfreezePage(const uint32_t page)
+    {
+        const uint8_t* frozen = mPageTable[page];
+        std::memcpy(ownPage(page), frozen, pageSize);
+        mPageTable[page] = ownPage(page);
+        mCopiedPages++;
+
+        release(frozen);
+    }
+
+    void releaseFrozenPages()
+    {
+        for (uint32_t page = 0; page < pageCount; page++)
+        {
+            if (mPageTable[page] == ownPage(page)) continue;
+
+            release(mPageTable[page]);
+            mPageTable[page] = ownPage(page);
+        }
+    }
+
+    std::array<uint8_t, Size> mBytes {};
+
+    // forking freezes pages, which changes where they are read from but not what they hold
+    mutable std::array<const uint8_t*, pageCount> mPageTable {};
+    mutable std::mutex mShareMutex;
+    uint64_t mCopiedPages {};
+};
@@ -0,0 +1,103 @@
+#include "PaletteMemory.h"
+
+#include "../SaveState/StateBuffer.h"
+
+#include <cstring>
+
+// BGR555 values of the four DMG shades, lightest first
+static constexpr std::array<uint16_t, 4> gDmgShades { 0x6BFC, 0x3B11, 0x29A6, 0x1061 };
+
+PaletteMemory::PaletteMemory()
+{
+    setColorConversion(ColorTable::PixelFormat::argb8888, ColorTable::ColorCorrection::none);
+}
+
+uint8_t PaletteMemory::specification(const bool objectPalettes) const
+{
+    // bit 6 is unused and always reads as set
+    return mSpecifications[objectPalettes] | 0b01000000;
+}
+
+void PaletteMemory::setSpecification(const bool objectPalettes, const uint8_t value)
+{
+    mSpecifications[objectPalettes] = value & 0b10111111;
+}
+
+uint8_t PaletteMemory::data(const bool objectPalettes) const
+{
+    const uint8_t byteIndex = (objectPalettes ? 64 : 0) + (mSpecifications[objectPalettes] & 0x3F);
+    return mPaletteRam[byteIndex];
+}
+
+uint8_t PaletteMemory::writeData(const bool objectPalettes, const uint8_t value)
+{
+    uint8_t& specification = mSpecifications[objectPalettes];
+    const uint8_t byteIndex = (objectPalettes ? 64 : 0) + (specification & 0x3F);
+
+    // bit 7 selects auto increment after each write
+    if (specification >> 7) specification = 0x80 | ((specification + 1) & 0x3F);
+
+    if (mPaletteRam[byteIndex] == value) return noPaletteChanged;
+    mPaletteRam[byteIndex] = value;
+
+    const uint8_t colorIndex = byteIndex / 2;
+    updateHostColor(colorIndex);
+
+    return colorIndex / colorsPerPalette;
+}
+
+void PaletteMemory::setColorConversion(const ColorTable::PixelFormat format, const ColorTable::ColorCorrection correction)
+{
+    mColorTable = &ColorTable::instance().table(format, correction);
+
+    for (uint8_t colorIndex = 0; colorIndex < mHostColors.size(); colorIndex++)
+    {
+        updateHostColor(colorIndex);
+    }
+
+    for (uint8_t shade = 0; shade < mDmgHostColors.size(); shade++)
+    {
+        mDmgHostColors[shade] = (*mColorTable)[gDmgShades[shade]];
+    }
+}
+
+void PaletteMemory::reset()
+{
+    mPaletteRam.fill(0);
+    mSpecifications.fill(0);
+
+    for (uint8_t colorIndex = 0; colorIndex < mHostColors.size(); colorIndex++)
+    {
+        updateHostColor(colorIndex);
+    }
+}
+
+void PaletteMemory::saveState(StateWriter& writer) const
+{
+    writer.write(mPaletteRam);
+    writer.write(mSpecifications);
+}
+
+uint16_t PaletteMemory::loadState(StateReader& reader)
+{
+    const std::array<uint8_t, paletteCount * colorsPerPalette * 2> previousRam = mPaletteRam;
+    reader.read(mPaletteRam);
+    reader.read(mSpecifications);
+
+    uint16_t changedPalettes = 0;
+    for (uint8_t colorIndex = 0; colorIndex < mHostColors.size(); colorIndex++)
+    {
+        if (std::memcmp(&mPaletteRam[colorIndex * 2], &previousRam[colorIndex * 2], 2) == 0) continue;
+
+        updateHostColor(colorIndex);
+        changedPalettes |= 1 << (colorIndex / colorsPerPalette);
+    }
+
+    return changedPalettes;
+}
+
+void PaletteMemory::updateHostColor(const uint8_t colorIndex)
+{
+    const uint16_t color = (mPaletteRam[colorIndex * 2] | (mPaletteRam[colorIndex * 2 + 1] << 8)) & 0x7FFF;
+    mHostColors[colorIndex] = (*mColorTable)[color];
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../../Display/ColorTable.h"
+
+#include <array>
+#include <cstdint>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup PPU
+
+    the GBC colour palette RAM (8 background and 8 object palettes of 4 BGR555 colours each).
+    Every write converts the changed colour to the host pixel format right away, so drawing a line
+    only copies colours out of the cache.
+*/
+
+class PaletteMemory
+{
+public:
+    PaletteMemory();
+    ~PaletteMemory() = default;
+
+    static constexpr uint8_t paletteCount = 16; // 0 - 7 background, 8 - 15 objects
+    static constexpr uint8_t colorsPerPalette = 4;
+    static constexpr uint8_t noPaletteChanged = 0xFF;
+
+    // BCPS/OCPS
+    uint8_t specification(const bool objectPalettes) const;
+    void setSpecification(const bool objectPalettes, const uint8_t value);
+
+    // BCPD/OCPD. Writing returns the number of the changed palette or noPaletteChanged
+    uint8_t data(const bool objectPalettes) const;
+    uint8_t writeData(const bool objectPalettes, const uint8_t value);
+
+    const uint32_t* backgroundColors(const uint8_t palette) const { return &mHostColors[palette * colorsPerPalette]; }
+    const uint32_t* objectColors(const uint8_t palette) const { return &mHostColors[(8 + palette) * colorsPerPalette]; }
+
+    // host colours of the four DMG shades, lightest first
+    const std::array<uint32_t, 4>& dmgColors() const { return mDmgHostColors; }
+    uint32_t whiteColor() const { return (*mColorTable)[0x7FFF]; }
+
+    void setColorConversion(const ColorTable::PixelFormat format, const ColorTable::ColorCorrection correction);
+
+    void reset();
+
+    // the host colours are converted again when loading. Loading returns one bit per palette it changed
+    void saveState(StateWriter& writer) const;
+    uint16_t loadState(StateReader& reader);
+
+private:
+    void updateHostColor(const uint8_t colorIndex);
+
+    std::array<uint8_t, paletteCount * colorsPerPalette * 2> mPaletteRam {}; // little endian BGR555
+    std::array<uint8_t, 2> mSpecifications {};
+
+    std::array<uint32_t, paletteCount * colorsPerPalette> mHostColors {};
+    std::array<uint32_t, 4> mDmgHostColors {};
+
+    const ColorTable::Table* mColorTable {};
+};
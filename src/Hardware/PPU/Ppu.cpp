@@ -0,0 +1,635 @@
+#include "Ppu.h"
+
+#include "../SaveState/StateBuffer.h"
+
+#include <algorithm>
+
+bool Ppu::LineRegisters::operator==(const LineRegisters& other) const
+{
+    return lcdControl == other.lcdControl
+        && scrollX == other.scrollX
+        && scrollY == other.scrollY
+        && windowX == other.windowX
+        && windowY == other.windowY
+        && windowLine == other.windowLine
+        && backgroundPalette == other.backgroundPalette
+        && objectPalette0 == other.objectPalette0
+        && objectPalette1 == other.objectPalette1
+        && colorMode == other.colorMode;
+}
+
+Ppu::Ppu(MemoryManager& memoryManager)
+    : mMemoryManager(memoryManager)
+{}
+
+bool Ppu::tick(const uint16_t cycles)
+{
+    const bool lcdEnabled = bitSet(mMemoryManager.ioRegister(lcdControlRegister), lcdEnableBit);
+    if (lcdEnabled != mLcdEnabled)
+    {
+        if (lcdEnabled)
+        {
+            enableLcd();
+        }
+        else
+        {
+            disableLcd();
+        }
+    }
+
+    mDot += cycles;
+
+    if (mLcdEnabled == false)
+    {
+        // keep delivering (blank) frames at the regular rate while the LCD is off
+        if (mDot < cyclesPerFrame) return false;
+
+        mDot -= cyclesPerFrame;
+        if (mDisplayData && mSkipFrame == false)
+        {
+            mDisplayData->fill(blankColor());
+            mBufferLineVersions[mDisplayBufferId].fill(0);
+        }
+        finishFrame();
+        return true;
+    }
+
+    bool frameCompleted = false;
+    while (advanceMode(frameCompleted)) {}
+
+    return frameCompleted;
+}
+
+void Ppu::setDisplayBuffer(DisplayData& displayData, const uint8_t bufferId)
+{
+    mDisplayData = &displayData;
+    mDisplayBufferId = bufferId;
+}
+
+const DisplayData& Ppu::displayData() const
+{
+    return *mDisplayData;
+}
+
+const Ppu::FrameStatistics& Ppu::lastFrameStatistics() const
+{
+    return mLastFrame;
+}
+
+void Ppu::setFrameSkipping(const bool skip)
+{
+    mSkipFrame = skip;
+}
+
+void Ppu::reset()
+{
+    if (mDisplayData) mDisplayData->fill(blankColor());
+    mLineColorIds.fill(0);
+    mLinePriorities.fill(false);
+    mLineStates.fill(LineState {});
+    for (std::array<uint32_t, gDisplayHeight>& lineVersions : mBufferLineVersions)
+    {
+        lineVersions.fill(0);
+    }
+    mLineObjectCount = 0;
+
+    mCurrentFrame = {};
+    mLastFrame = {};
+
+    mMode = PpuMode::oam_scan;
+    mDot = 0;
+    mLine = 0;
+    mWindowLine = 0;
+
+    mLcdEnabled = false;
+    mStatInterruptLine = false;
+    mDisplayCleared = true;
+    mSkipFrame = false;
+}
+
+bool Ppu::advanceMode(bool& frameCompleted)
+{
+    switch (mMode)
+    {
+        case PpuMode::oam_scan:
+        {
+            if (mDot < oamScanDots) return false;
+
+            setMode(PpuMode::drawing);
+            return true;
+        }
+        case PpuMode::drawing:
+        {
+            if (mDot < oamScanDots + drawingDots) return false;
+
+            renderLine();
+            setMode(PpuMode::horizontal_blank);
+            return true;
+        }
+        case PpuMode::horizontal_blank:
+        {
+            if (mDot < dotsPerLine) return false;
+
+            mDot -= dotsPerLine;
+            setLine(mLine + 1);
+
+            if (mLine == gDisplayHeight)
+            {
+                setMode(PpuMode::vertical_blank);
+                mMemoryManager.requestInterrupt(InterruptType::vertical_blank);
+
+                finishFrame();
+                frameCompleted = true;
+            }
+            else
+            {
+                setMode(PpuMode::oam_scan);
+            }
+            return true;
+        }
+        case PpuMode::vertical_blank:
+        {
+            if (mDot < dotsPerLine) return false;
+
+            mDot -= dotsPerLine;
+            if (mLine + 1 == linesPerFrame)
+            {
+                mWindowLine = 0;
+                setLine(0);
+                setMode(PpuMode::oam_scan);
+            }
+            else
+            {
+                setLine(mLine + 1);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Ppu::setMode(const PpuMode mode)
+{
+    mMode = mode;
+
+    const uint8_t status = mMemoryManager.ioRegister(lcdStatusRegister);
+    mMemoryManager.setIoRegister(lcdStatusRegister, (status & 0b11111100) | static_cast<uint8_t>(mode));
+
+    updateStatInterruptLine();
+}
+
+void Ppu::setLine(const uint8_t line)
+{
+    mLine = line;
+    mMemoryManager.setIoRegister(lcdYCoordinateRegister, line);
+
+    const bool coincidence = (line == mMemoryManager.ioRegister(lcdYCompareRegister));
+    const uint8_t status = mMemoryManager.ioRegister(lcdStatusRegister);
+    mMemoryManager.setIoRegister(lcdStatusRegister, (status & 0b11111011) | (coincidence << 2));
+
+    updateStatInterruptLine();
+}
+
+void Ppu::updateStatInterruptLine()
+{
+    // the STAT interrupt is requested on the rising edge of the OR of all enabled sources
+    const uint8_t status = mMemoryManager.ioRegister(lcdStatusRegister);
+    const bool interruptLine = (bitSet(status, 3) && mMode == PpuMode::horizontal_blank)
+                            || (bitSet(status, 4) && mMode == PpuMode::vertical_blank)
+                            || (bitSet(status, 5) && mMode == PpuMode::oam_scan)
+                            || (bitSet(status, 6) && bitSet(status, 2));
+
+    if (interruptLine && mStatInterruptLine == false)
+    {
+        mMemoryManager.requestInterrupt(InterruptType::lcd_status);
+    }
+
+    mStatInterruptLine = interruptLine;
+}
+
+void Ppu::enableLcd()
+{
+    mLcdEnabled = true;
+    mDot = 0;
+    mWindowLine = 0;
+
+    setLine(0);
+    setMode(PpuMode::oam_scan);
+}
+
+void Ppu::disableLcd()
+{
+    mLcdEnabled = false;
+    mDot = 0;
+
+    setLine(0);
+    setMode(PpuMode::horizontal_blank);
+
+    // a disabled LCD shows a blank screen; nothing drawn before can be reused afterwards
+    invalidateLines();
+    mDisplayCleared = true;
+}
+
+void Ppu::finishFrame()
+{
+    if (mSkipFrame)
+    {
+        // whether the picture changed is only known once a frame is drawn again
+        mCurrentFrame.frameSkipped = true;
+    }
+    else
+    {
+        mCurrentFrame.frameChanged = mCurrentFrame.frameChanged || mDisplayCleared;
+        mDisplayCleared = false;
+    }
+
+    mLastFrame = mCurrentFrame;
+    mCurrentFrame = {};
+}
+
+void Ppu::renderLine()
+{
+    if (mSkipFrame)
+    {
+        skipLine();
+        return;
+    }
+
+    LineRegisters registers {};
+    registers.lcdControl = mMemoryManager.ioRegister(lcdControlRegister);
+    registers.scrollX = mMemoryManager.ioRegister(scrollXRegister);
+    registers.scrollY = mMemoryManager.ioRegister(scrollYRegister);
+    registers.windowX = mMemoryManager.ioRegister(windowXRegister);
+    registers.windowY = mMemoryManager.ioRegister(windowYRegister);
+    registers.windowLine = mWindowLine;
+    registers.backgroundPalette = mMemoryManager.ioRegister(backgroundPaletteRegister);
+    registers.objectPalette0 = mMemoryManager.ioRegister(objectPalette0Register);
+    registers.objectPalette1 = mMemoryManager.ioRegister(objectPalette1Register);
+    registers.colorMode = mMemoryManager.colorMode();
+
+    const bool drawWindow = windowVisible(registers);
+    const uint64_t objectMask = selectObjects(registers);
+
+    // the window keeps its own line counter which only advances on lines showing the window
+    if (drawWindow) mWindowLine++;
+
+    LineState& state = mLineStates[mLine];
+    const uint64_t writeStamp = mMemoryManager.videoWriteVersions().writeCounter;
+
+    // objects that left the line since the previous frame have to be considered as well
+    const bool unchanged = state.valid
+                        && state.registers == registers
+                        && lineInputsChanged(registers, objectMask | state.objectMask, state.checkedAt) == false;
+    if (unchanged == false)
+    {
+        state.registers = registers;
+        state.objectMask = objectMask;
+        state.contentVersion++;
+        state.valid = true;
+
+        mCurrentFrame.frameChanged = true;
+    }
+    state.checkedAt = writeStamp;
+
+    uint32_t& bufferLineVersion = mBufferLineVersions[mDisplayBufferId][mLine];
+    if (mDisplayData == nullptr || bufferLineVersion == state.contentVersion)
+    {
+        mCurrentFrame.linesSkipped++;
+        return;
+    }
+
+    const bool signedAddressing = bitSet(registers.lcdControl, tileDataBit) == false;
+
+    // on the GBC, LCDC bit 0 only takes away the background's priority over objects
+    if (registers.colorMode || bitSet(registers.lcdControl, backgroundEnableBit))
+    {
+        drawTileMapRow(registers, bitSet(registers.lcdControl, backgroundMapBit), registers.scrollX, registers.scrollY + mLine, 0, signedAddressing);
+
+        if (drawWindow)
+        {
+            const uint8_t windowStart = registers.windowX < 7 ? 0 : registers.windowX - 7;
+            const uint8_t windowMapX = registers.windowX < 7 ? 7 - registers.windowX : 0;
+
+            drawTileMapRow(registers, bitSet(registers.lcdControl, windowMapBit), windowMapX, registers.windowLine, windowStart, signedAddressing);
+        }
+    }
+    else
+    {
+        mLineColorIds.fill(0);
+        std::fill_n(mDisplayData->begin() + mLine * gDisplayWidth, gDisplayWidth, blankColor());
+    }
+
+    if (bitSet(registers.lcdControl, objectEnableBit))
+    {
+        drawObjects(registers);
+    }
+
+    bufferLineVersion = state.contentVersion;
+    mCurrentFrame.linesRendered++;
+}
+
+void Ppu::skipLine()
+{
+    // the window line counter is the only drawing state that carries over into the following lines
+    LineRegisters registers {};
+    registers.lcdControl = mMemoryManager.ioRegister(lcdControlRegister);
+    registers.windowX = mMemoryManager.ioRegister(windowXRegister);
+    registers.windowY = mMemoryManager.ioRegister(windowYRegister);
+    registers.colorMode = mMemoryManager.colorMode();
+
+    if (windowVisible(registers)) mWindowLine++;
+
+    mCurrentFrame.linesSkipped++;
+}
+
+bool Ppu::windowVisible(const LineRegisters& registers) const
+{
+    return bitSet(registers.lcdControl, windowEnableBit)
+        && (registers.colorMode || bitSet(registers.lcdControl, backgroundEnableBit))
+        && registers.windowY <= mLine
+        && registers.windowX <= 166;
+}
+
+uint64_t Ppu::selectObjects(const LineRegisters& registers)
+{
+    mLineObjectCount = 0;
+    if (bitSet(registers.lcdControl, objectEnableBit) == false) return 0;
+
+    const int16_t objectHeight = bitSet(registers.lcdControl, objectSizeBit) ? 16 : 8;
+
+    uint64_t objectMask = 0;
+    for (uint8_t objectId = 0; objectId < oamObjectCount && mLineObjectCount < objectsPerLine; objectId++)
+    {
+        const int16_t top = mMemoryManager.oamAt(objectId * oamObjectSize) - 16;
+        if (mLine >= top && mLine < top + objectHeight)
+        {
+            mLineObjects[mLineObjectCount++] = objectId;
+            objectMask |= (uint64_t { 1 } << objectId);
+        }
+    }
+
+    return objectMask;
+}
+
+bool Ppu::lineInputsChanged(const LineRegisters& registers, const uint64_t objectMask, const uint64_t checkedAt) const
+{
+    const MemoryManager::VideoWriteVersions& versions = mMemoryManager.videoWriteVersions();
+    if (versions.colorConversion > checkedAt) return true;
+
+    const bool signedAddressing = bitSet(registers.lcdControl, tileDataBit) == false;
+
+    if (registers.colorMode || bitSet(registers.lcdControl, backgroundEnableBit))
+    {
+        const uint8_t mapY = registers.scrollY + mLine;
+        if (tileMapRowChanged(registers, bitSet(registers.lcdControl, backgroundMapBit), mapY / 8, registers.scrollX / 8, signedAddressing, checkedAt)) return true;
+
+        if (windowVisible(registers) && tileMapRowChanged(registers, bitSet(registers.lcdControl, windowMapBit), registers.windowLine / 8, 0, signedAddressing, checkedAt)) return true;
+    }
+
+    if (objectMask == 0) return false;
+
+    const bool tallObjects = bitSet(registers.lcdControl, objectSizeBit);
+
+    for (uint8_t objectId = 0; objectId < oamObjectCount; objectId++)
+    {
+        if (((objectMask >> objectId) & 0b1) == 0) continue;
+
+        if (versions.objects[objectId] > checkedAt) return true;
+
+        const uint8_t attributes = mMemoryManager.oamAt(objectId * oamObjectSize + 3);
+        uint16_t tileBankOffset = 0;
+        if (registers.colorMode)
+        {
+            if (versions.palettes[8 + (attributes & 0b111)] > checkedAt) return true;
+            tileBankOffset = bitSet(attributes, tileBankBit) * tilesPerBank;
+        }
+
+        // objects always use the unsigned tile addressing
+        const uint8_t tileIndex = mMemoryManager.oamAt(objectId * oamObjectSize + 2);
+        if (tallObjects)
+        {
+            if (versions.tileData[tileBankOffset + (tileIndex & 0xFE)] > checkedAt || versions.tileData[tileBankOffset + (tileIndex | 0b1)] > checkedAt) return true;
+        }
+        else if (versions.tileData[tileBankOffset + tileIndex] > checkedAt)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Ppu::tileMapRowChanged(const LineRegisters& registers, const bool highMap, const uint8_t row, const uint8_t firstColumn, const bool signedAddressing, const uint64_t checkedAt) const
+{
+    const MemoryManager::VideoWriteVersions& versions = mMemoryManager.videoWriteVersions();
+
+    // tile indices live in bank 0, their GBC attributes at the same place in bank 1
+    const uint8_t mapRow = (highMap ? 32 : 0) + row;
+    if (versions.tileMapRows[mapRow] > checkedAt) return true;
+    if (registers.colorMode && versions.tileMapRows[64 + mapRow] > checkedAt) return true;
+
+    const uint16_t rowStart = (highMap ? highTileMapStart : lowTileMapStart) + row * 32;
+    for (uint8_t column = 0; column < tilesPerLine; column++)
+    {
+        const uint16_t mapAddress = rowStart + ((firstColumn + column) & 31);
+        const uint8_t tileIndex = mMemoryManager.videoRamAt(0, mapAddress);
+
+        uint16_t tileBankOffset = 0;
+        if (registers.colorMode)
+        {
+            const uint8_t attributes = mMemoryManager.videoRamAt(1, mapAddress);
+            if (versions.palettes[attributes & 0b111] > checkedAt) return true;
+
+            tileBankOffset = bitSet(attributes, tileBankBit) * tilesPerBank;
+        }
+
+        if (versions.tileData[tileBankOffset + tileNumber(tileIndex, signedAddressing)] > checkedAt) return true;
+    }
+
+    return false;
+}
+
+void Ppu::drawTileMapRow(const LineRegisters& registers, const bool highMap, const uint8_t mapX, const uint8_t mapY, const uint8_t startPixel, const bool signedAddressing)
+{
+    const uint16_t rowStart = (highMap ? highTileMapStart : lowTileMapStart) + (mapY / 8) * 32;
+    const PaletteMemory& paletteMemory = mMemoryManager.paletteMemory();
+
+    // DMG colours go through BGP first; the resulting four host colours are the same for every tile
+    std::array<uint32_t, 4> dmgColors {};
+    if (registers.colorMode == false)
+    {
+        for (uint8_t colorId = 0; colorId < 4; colorId++)
+        {
+            dmgColors[colorId] = paletteMemory.dmgColors()[(registers.backgroundPalette >> (colorId * 2)) & 0b11];
+        }
+    }
+
+    uint32_t* lineData = mDisplayData->data() + mLine * gDisplayWidth;
+    uint8_t x = mapX; // wraps around at the end of the 256 pixel wide map
+
+    uint16_t pixel = startPixel;
+    while (pixel < gDisplayWidth)
+    {
+        const uint16_t mapAddress = rowStart + x / 8;
+        const uint8_t tileIndex = mMemoryManager.videoRamAt(0, mapAddress);
+
+        uint8_t tileRow = mapY % 8;
+        uint8_t tileBank = 0;
+        bool flipX = false;
+        bool priority = false;
+        const uint32_t* colors = dmgColors.data();
+
+        if (registers.colorMode)
+        {
+            const uint8_t attributes = mMemoryManager.videoRamAt(1, mapAddress);
+
+            tileBank = bitSet(attributes, tileBankBit);
+            flipX = bitSet(attributes, objectFlipXBit);
+            priority = bitSet(attributes, objectPriorityBit);
+            if (bitSet(attributes, objectFlipYBit)) tileRow = 7 - tileRow;
+
+            colors = paletteMemory.backgroundColors(attributes & 0b111);
+        }
+
+        const uint16_t tileAddress = vRamMemoryStart + tileNumber(tileIndex, signedAddressing) * tileSize + tileRow * 2;
+        const uint8_t lowBits = mMemoryManager.videoRamAt(tileBank, tileAddress);
+        const uint8_t highBits = mMemoryManager.videoRamAt(tileBank, tileAddress + 1);
+
+        for (uint8_t tileColumn = x % 8; tileColumn < 8 && pixel < gDisplayWidth; tileColumn++, pixel++, x++)
+        {
+            const uint8_t shift = flipX ? tileColumn : 7 - tileColumn;
+            const uint8_t colorId = (((highBits >> shift) & 0b1) << 1) | ((lowBits >> shift) & 0b1);
+
+            mLineColorIds[pixel] = colorId;
+            mLinePriorities[pixel] = priority;
+            lineData[pixel] = colors[colorId];
+        }
+    }
+}
+
+void Ppu::drawObjects(const LineRegisters& registers)
+{
+    // the GBC prioritises objects by OAM order alone; the DMG by lower X coordinate first
+    if (registers.colorMode == false)
+    {
+        std::stable_sort(mLineObjects.begin(), mLineObjects.begin() + mLineObjectCount, [this](const uint8_t first, const uint8_t second)
+        {
+            return mMemoryManager.oamAt(first * oamObjectSize + 1) < mMemoryManager.oamAt(second * oamObjectSize + 1);
+        });
+    }
+
+    const bool tallObjects = bitSet(registers.lcdControl, objectSizeBit);
+    const bool backgroundPriority = registers.colorMode == false || bitSet(registers.lcdControl, backgroundEnableBit);
+    const PaletteMemory& paletteMemory = mMemoryManager.paletteMemory();
+
+    uint32_t* lineData = mDisplayData->data() + mLine * gDisplayWidth;
+
+    // a pixel claimed by a higher priority object stays claimed even if that object hides behind the background
+    std::array<bool, gDisplayWidth> pixelClaimed {};
+
+    for (uint8_t index = 0; index < mLineObjectCount; index++)
+    {
+        const uint8_t oamOffset = mLineObjects[index] * oamObjectSize;
+        const int16_t top = mMemoryManager.oamAt(oamOffset) - 16;
+        const int16_t left = mMemoryManager.oamAt(oamOffset + 1) - 8;
+        uint8_t tileIndex = mMemoryManager.oamAt(oamOffset + 2);
+        const uint8_t attributes = mMemoryManager.oamAt(oamOffset + 3);
+
+        uint8_t objectRow = mLine - top;
+        if (bitSet(attributes, objectFlipYBit)) objectRow = (tallObjects ? 15 : 7) - objectRow;
+
+        if (tallObjects)
+        {
+            tileIndex = (tileIndex & 0xFE) | (objectRow >= 8);
+            objectRow %= 8;
+        }
+
+        std::array<uint32_t, 4> dmgColors {};
+        const uint32_t* colors = dmgColors.data();
+        uint8_t tileBank = 0;
+
+        if (registers.colorMode)
+        {
+            colors = paletteMemory.objectColors(attributes & 0b111);
+            tileBank = bitSet(attributes, tileBankBit);
+        }
+        else
+        {
+            const uint8_t palette = bitSet(attributes, objectPaletteBit) ? registers.objectPalette1 : registers.objectPalette0;
+            for (uint8_t colorId = 0; colorId < 4; colorId++)
+            {
+                dmgColors[colorId] = paletteMemory.dmgColors()[(palette >> (colorId * 2)) & 0b11];
+            }
+        }
+
+        const uint16_t tileAddress = vRamMemoryStart + tileIndex * tileSize + objectRow * 2;
+        const uint8_t lowBits = mMemoryManager.videoRamAt(tileBank, tileAddress);
+        const uint8_t highBits = mMemoryManager.videoRamAt(tileBank, tileAddress + 1);
+
+        for (uint8_t objectColumn = 0; objectColumn < 8; objectColumn++)
+        {
+            const int16_t pixel = left + objectColumn;
+            if (pixel < 0 || pixel >= gDisplayWidth || pixelClaimed[pixel]) continue;
+
+            const uint8_t shift = bitSet(attributes, objectFlipXBit) ? objectColumn : 7 - objectColumn;
+            const uint8_t colorId = (((highBits >> shift) & 0b1) << 1) | ((lowBits >> shift) & 0b1);
+            if (colorId == 0) continue; // transparent
+
+            pixelClaimed[pixel] = true;
+
+            const bool behindBackground = bitSet(attributes, objectPriorityBit) || mLinePriorities[pixel];
+            if (backgroundPriority && behindBackground && mLineColorIds[pixel] != 0) continue;
+
+            lineData[pixel] = colors[colorId];
+        }
+    }
+}
+
+uint32_t Ppu::blankColor() const
+{
+    const PaletteMemory& paletteMemory = mMemoryManager.paletteMemory();
+    return mMemoryManager.colorMode() ? paletteMemory.whiteColor() : paletteMemory.dmgColors()[0];
+}
+
+uint16_t Ppu::tileNumber(const uint8_t tileIndex, const bool signedAddressing)
+{
+    // unsigned addressing starts at 0x8000; signed addressing is centered around 0x9000 (tile 256)
+    return signedAddressing ? 256 + static_cast<int8_t>(tileIndex) : tileIndex;
+}
+
+bool Ppu::bitSet(const uint8_t value, const uint8_t bit)
+{
+    return (value >> bit) & 0b1;
+}
+
+void Ppu::saveState(StateWriter& writer) const
+{
+    writer.write(mMode);
+    writer.write(mDot);
+    writer.write(mLine);
+    writer.write(mWindowLine);
+
+    writer.write(mLcdEnabled);
+    writer.write(mStatInterruptLine);
+}
+
+void Ppu::loadState(StateReader& reader)
+{
+    reader.read(mMode);
+    reader.read(mDot);
+    reader.read(mLine);
+    reader.read(mWindowLine);
+
+    reader.read(mLcdEnabled);
+    reader.read(mStatInterruptLine);
+}
+
+void Ppu::invalidateLines()
+{
+    // the content versions keep counting up, so no display buffer can claim to hold a line drawn from now on
+    for (LineState& state : mLineStates)
+    {
+        state.valid = false;
+    }
+}
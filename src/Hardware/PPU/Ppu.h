@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../../Application/ApplicationDefines.h"
+#include "../Memory/MemoryManager.h"
+#include "PpuDefines.h"
+
+#include <array>
+#include <cstdint>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup PPU
+
+    class that generates the LCD timing and draws the picture line by line.
+    A line only gets a new content version if one of its inputs (tiles, tile map row, objects, scroll, palettes, LCDC)
+    changed since the previous frame. The PPU draws into one of several rotating display buffers and only
+    redraws the lines whose content version in that buffer is outdated.
+*/
+
+class Ppu
+{
+public:
+    Ppu(MemoryManager& memoryManager);
+    ~Ppu() = default;
+
+    struct FrameStatistics
+    {
+        uint8_t linesRendered {};
+        uint8_t linesSkipped {};
+
+        bool frameChanged {};
+        bool frameSkipped {}; // nothing was drawn; the display buffer still holds an older frame
+    };
+
+    // advances the PPU by the given amount of T-cycles. Returns true if a frame was completed
+    bool tick(const uint16_t cycles);
+
+    // the buffer the following lines are drawn into. The id tells the PPU which lines the buffer already holds
+    void setDisplayBuffer(DisplayData& displayData, const uint8_t bufferId);
+    const DisplayData& displayData() const;
+    const FrameStatistics& lastFrameStatistics() const;
+
+    // a skipped frame keeps its timing, STAT and interrupts but draws no pixels.
+    // Meant to be called right after tick() completed a frame and applies to the following one
+    void setFrameSkipping(const bool skip);
+
+    void reset();
+
+    /*  the line cache is not part of the state. It stays valid across a load: the memory stamps what the loaded
+        state changes, so only the lines drawn from that get drawn again
+    */
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+    // every line gets drawn again, for video memory that changed without write stamps
+    void invalidateLines();
+
+private:
+    enum class PpuMode : uint8_t
+    {
+        horizontal_blank = 0,
+        vertical_blank = 1,
+        oam_scan = 2,
+        drawing = 3
+    };
+
+    // register values a line was drawn with
+    struct LineRegisters
+    {
+        uint8_t lcdControl {};
+        uint8_t scrollX {};
+        uint8_t scrollY {};
+        uint8_t windowX {};
+        uint8_t windowY {};
+        uint8_t windowLine {};
+        uint8_t backgroundPalette {};
+        uint8_t objectPalette0 {};
+        uint8_t objectPalette1 {};
+        bool colorMode {};
+
+        bool operator==(const LineRegisters& other) const;
+        bool operator!=(const LineRegisters& other) const { return !(*this == other); }
+    };
+
+    struct LineState
+    {
+        LineRegisters registers {};
+        uint64_t objectMask {}; // one bit per OAM entry drawn on the line
+        uint64_t checkedAt {}; // video write stamp at the time the inputs were last compared
+
+        uint32_t contentVersion {};
+
+        bool valid {};
+    };
+
+    bool advanceMode(bool& frameCompleted);
+    void setMode(const PpuMode mode);
+    void setLine(const uint8_t line);
+    void updateStatInterruptLine();
+
+    void enableLcd();
+    void disableLcd();
+    void finishFrame();
+
+    void renderLine();
+    void skipLine();
+    bool windowVisible(const LineRegisters& registers) const;
+    uint64_t selectObjects(const LineRegisters& registers);
+    bool lineInputsChanged(const LineRegisters& registers, const uint64_t objectMask, const uint64_t checkedAt) const;
+    bool tileMapRowChanged(const LineRegisters& registers, const bool highMap, const uint8_t row, const uint8_t firstColumn, const bool signedAddressing, const uint64_t checkedAt) const;
+
+    void drawTileMapRow(const LineRegisters& registers, const bool highMap, const uint8_t mapX, const uint8_t mapY, const uint8_t startPixel, const bool signedAddressing);
+    void drawObjects(const LineRegisters& registers);
+
+    uint32_t blankColor() const;
+
+    static uint16_t tileNumber(const uint8_t tileIndex, const bool signedAddressing);
+    static bool bitSet(const uint8_t value, const uint8_t bit);
+
+    MemoryManager& mMemoryManager;
+
+    DisplayData* mDisplayData {};
+    uint8_t mDisplayBufferId {};
+
+    std::array<uint8_t, gDisplayWidth> mLineColorIds {}; // background/window colour ids before palette; needed for object priority
+    std::array<bool, gDisplayWidth> mLinePriorities {}; // GBC background tiles that are drawn over objects
+    std::array<LineState, gDisplayHeight> mLineStates {};
+    std::array<std::array<uint32_t, gDisplayHeight>, maxDisplayBuffers> mBufferLineVersions {}; // content version of each line per buffer
+
+    std::array<uint8_t, objectsPerLine> mLineObjects {};
+    uint8_t mLineObjectCount {};
+
+    FrameStatistics mCurrentFrame {};
+    FrameStatistics mLastFrame {};
+
+    PpuMode mMode { PpuMode::oam_scan };
+    uint32_t mDot {}; // counts up to a whole frame while the LCD is off
+    uint8_t mLine {};
+    uint8_t mWindowLine {};
+
+    bool mLcdEnabled {};
+    bool mStatInterruptLine {};
+    bool mDisplayCleared {};
+    bool mSkipFrame {};
+};
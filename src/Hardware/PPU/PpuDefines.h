@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// timings are given in T-cycles (dots); one machine cycle takes four of them
+static constexpr uint8_t cyclesPerMachineCycle = 4;
+
+static constexpr uint16_t oamScanDots = 80;
+static constexpr uint16_t drawingDots = 172; // TODO varies with scroll, window and objects on hardware
+static constexpr uint16_t dotsPerLine = 456;
+
+static constexpr uint8_t linesPerFrame = 154;
+static constexpr uint32_t cyclesPerFrame = dotsPerLine * linesPerFrame; // 70224
+
+static constexpr uint8_t objectsPerLine = 10;
+
+// amount of display buffers the PPU keeps track of (triple buffering)
+static constexpr uint8_t maxDisplayBuffers = 3;
+
+// 20 tiles cover the screen; a horizontally scrolled line touches one more
+static constexpr uint8_t tilesPerLine = 21;
+
+static constexpr uint16_t lowTileMapStart = 0x9800;
+static constexpr uint16_t highTileMapStart = 0x9C00;
+
+// LCDC bits
+static constexpr uint8_t backgroundEnableBit = 0;
+static constexpr uint8_t objectEnableBit = 1;
+static constexpr uint8_t objectSizeBit = 2;
+static constexpr uint8_t backgroundMapBit = 3;
+static constexpr uint8_t tileDataBit = 4;
+static constexpr uint8_t windowEnableBit = 5;
+static constexpr uint8_t windowMapBit = 6;
+static constexpr uint8_t lcdEnableBit = 7;
+
+// object (and GBC tile map) attribute bits
+static constexpr uint8_t tileBankBit = 3;
+static constexpr uint8_t objectPaletteBit = 4;
+static constexpr uint8_t objectFlipXBit = 5;
+static constexpr uint8_t objectFlipYBit = 6;
+static constexpr uint8_t objectPriorityBit = 7;
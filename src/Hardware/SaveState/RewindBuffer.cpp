@@ -0,0 +1,368 @@
+#include "RewindBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// equal bytes shorter than this stay part of a literal; a new run costs at least two length bytes
+static constexpr size_t gMinEqualRun = 8;
+
+static size_t skipEqual(const uint8_t* state, const uint8_t* reference, size_t position, const size_t end)
+{
+    while (position + sizeof(uint64_t) <= end)
+    {
+        uint64_t stateWord;
+        uint64_t referenceWord;
+        std::memcpy(&stateWord, state + position, sizeof(uint64_t));
+        std::memcpy(&referenceWord, reference + position, sizeof(uint64_t));
+        if (stateWord != referenceWord) break;
+
+        position += sizeof(uint64_t);
+    }
+
+    while (position < end && state[position] == reference[position])
+    {
+        position++;
+    }
+
+    return position;
+}
+
+static void writeLength(std::vector<uint8_t>& output, size_t value)
+{
+    while (value >= 0x80)
+    {
+        output.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    output.push_back(static_cast<uint8_t>(value));
+}
+
+static bool readLength(const uint8_t*& data, const uint8_t* end, size_t& value)
+{
+    value = 0;
+    for (uint8_t shift = 0; data < end && shift < 64; shift += 7)
+    {
+        const uint8_t byte = *data++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+
+    return false;
+}
+
+/*  the state XORed with the reference as a sequence of (equal run length, literal length, literal bytes).
+    Lengths are LEB128 encoded
+*/
+static void encodeDifference(const uint8_t* state, const uint8_t* reference, const size_t size, std::vector<uint8_t>& output)
+{
+    output.clear();
+
+    size_t position = 0;
+    while (position < size)
+    {
+        const size_t equalStart = position;
+        position = skipEqual(state, reference, position, size);
+
+        const size_t literalStart = position;
+        while (position < size)
+        {
+            if (state[position] != reference[position])
+            {
+                position++;
+                continue;
+            }
+
+            const size_t runEnd = skipEqual(state, reference, position, std::min(size, position + gMinEqualRun));
+            if (runEnd - position >= gMinEqualRun || runEnd == size) break;
+
+            position = runEnd;
+        }
+
+        writeLength(output, literalStart - equalStart);
+        writeLength(output, position - literalStart);
+
+        const size_t outputPosition = output.size();
+        output.resize(outputPosition + (position - literalStart));
+        for (size_t index = literalStart; index < position; index++)
+        {
+            output[outputPosition + index - literalStart] = state[index] ^ reference[index];
+        }
+    }
+}
+
+static bool decodeDifference(const uint8_t* data, const size_t dataSize, const uint8_t* reference, uint8_t* state, const size_t size)
+{
+    std::memcpy(state, reference, size);
+
+    const uint8_t* end = data + dataSize;
+    size_t position = 0;
+    while (data < end)
+    {
+        size_t equalLength = 0;
+        size_t literalLength = 0;
+        if (!readLength(data, end, equalLength) || !readLength(data, end, literalLength)) return false;
+
+        position += equalLength;
+        if (position > size || literalLength > size - position || literalLength > static_cast<size_t>(end - data)) return false;
+
+        for (size_t index = 0; index < literalLength; index++)
+        {
+            state[position + index] ^= data[index];
+        }
+
+        data += literalLength;
+        position += literalLength;
+    }
+
+    return position == size;
+}
+
+RewindBuffer::~RewindBuffer()
+{
+    endRewind();
+}
+
+void RewindBuffer::setCapacity(const size_t bytes)
+{
+    endRewind();
+
+    mStorage.assign(bytes, 0);
+    mStorage.shrink_to_fit();
+
+    clear();
+}
+
+void RewindBuffer::push(const std::vector<uint8_t>& state)
+{
+    if (mStorage.empty() || mRewinding) return;
+
+    if (mZeroState.size() != state.size()) mZeroState.assign(state.size(), 0);
+
+    bool keyframe = mFramesSinceKeyframe >= keyframeInterval || mKeyframeState.size() != state.size();
+    encodeDifference(state.data(), keyframe ? mZeroState.data() : mKeyframeState.data(), state.size(), mEncoded);
+
+    if (store(keyframe, state.size()) == false)
+    {
+        // the ring wrapped around within one keyframe interval and took the keyframe with it
+        keyframe = true;
+        encodeDifference(state.data(), mZeroState.data(), state.size(), mEncoded);
+        if (store(keyframe, state.size()) == false) return;
+    }
+
+    if (keyframe)
+    {
+        mKeyframeState = state;
+        mKeyframeId = mNextId - 1;
+        mFramesSinceKeyframe = 0;
+    }
+    mFramesSinceKeyframe++;
+}
+
+void RewindBuffer::beginRewind()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mStorage.empty() || mRewinding) return;
+
+    mRewinding = true;
+    mStopDecoding = false;
+    mDecodableCount = mEntries.size();
+    mDecodeCursor = mEntries.empty() ? 0 : mEntries.back().id;
+
+    mDecoder = std::thread(&RewindBuffer::decodeLoop, this);
+}
+
+bool RewindBuffer::popState(std::vector<uint8_t>& state)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mRewinding == false) return false;
+
+    mCondition.wait(lock, [this] { return mDecoded.empty() == false || mDecodableCount == 0; });
+    if (mDecoded.empty()) return false;
+
+    // the caller's previous buffer goes back into the pool
+    std::swap(state, mDecoded.front().data);
+    mFreeBuffers.push_back(std::move(mDecoded.front().data));
+    mDecoded.pop_front();
+
+    // the state just handed out is the newest one; its space gets written again first
+    const Entry& newest = mEntries.back();
+    mWritePosition = newest.offset;
+    mUsedBytes -= newest.size;
+    mNextId = newest.id;
+    mEntries.pop_back();
+
+    mCondition.notify_all();
+    return true;
+}
+
+void RewindBuffer::endRewind()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mRewinding == false) return;
+
+        mStopDecoding = true;
+    }
+    mCondition.notify_all();
+    mDecoder.join();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRewinding = false;
+
+    for (DecodedState& decoded : mDecoded)
+    {
+        mFreeBuffers.push_back(std::move(decoded.data));
+    }
+    mDecoded.clear();
+
+    // the keyframe the encoder refers to may be gone, and ids get handed out again
+    mFramesSinceKeyframe = keyframeInterval;
+    mCachedKeyframeId = UINT64_MAX;
+}
+
+void RewindBuffer::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mWritePosition = 0;
+    mUsedBytes = 0;
+
+    mKeyframeState.clear();
+    mFramesSinceKeyframe = keyframeInterval;
+    mCachedKeyframeId = UINT64_MAX;
+}
+
+size_t RewindBuffer::stateCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+size_t RewindBuffer::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsedBytes;
+}
+
+bool RewindBuffer::store(const bool keyframe, const size_t stateSize)
+{
+    const size_t size = mEncoded.size();
+    if (size > mStorage.size()) return false;
+
+    size_t position = mWritePosition;
+    if (position + size > mStorage.size()) position = 0;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // the oldest states are the ones right behind the write position
+    while (mEntries.empty() == false)
+    {
+        const Entry& oldest = mEntries.front();
+        const bool overlaps = oldest.offset < position + size && position < oldest.offset + oldest.size;
+        if (overlaps == false) break;
+
+        dropOldest();
+    }
+
+    if (keyframe == false && findEntry(mKeyframeId) == nullptr) return false;
+
+    std::memcpy(mStorage.data() + position, mEncoded.data(), size);
+
+    Entry entry {};
+    entry.id = mNextId++;
+    entry.keyframeId = keyframe ? entry.id : mKeyframeId;
+    entry.offset = position;
+    entry.size = static_cast<uint32_t>(size);
+    entry.stateSize = static_cast<uint32_t>(stateSize);
+    mEntries.push_back(entry);
+
+    mWritePosition = position + size;
+    mUsedBytes += size;
+    return true;
+}
+
+const RewindBuffer::Entry* RewindBuffer::findEntry(const uint64_t id) const
+{
+    // ids are consecutive from the oldest to the newest entry
+    if (mEntries.empty() || id < mEntries.front().id || id > mEntries.back().id) return nullptr;
+    return &mEntries[id - mEntries.front().id];
+}
+
+void RewindBuffer::dropOldest()
+{
+    mUsedBytes -= mEntries.front().size;
+    mEntries.pop_front();
+
+    // deltas without their keyframe cannot be decoded anymore
+    while (mEntries.empty() == false && mEntries.front().keyframeId != mEntries.front().id)
+    {
+        mUsedBytes -= mEntries.front().size;
+        mEntries.pop_front();
+    }
+}
+
+void RewindBuffer::decodeLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this] { return mStopDecoding || (mDecodableCount > 0 && mDecoded.size() < prefetchDepth); });
+        if (mStopDecoding) return;
+
+        // only newer entries than these get removed meanwhile, and nothing is written
+        const Entry entry = *findEntry(mDecodeCursor);
+        const Entry keyframe = *findEntry(entry.keyframeId);
+        mDecodeCursor--;
+
+        DecodedState decoded;
+        decoded.id = entry.id;
+        if (mFreeBuffers.empty() == false)
+        {
+            decoded.data = std::move(mFreeBuffers.back());
+            mFreeBuffers.pop_back();
+        }
+
+        lock.unlock();
+        const bool valid = decodeEntry(entry, keyframe, decoded.data);
+        lock.lock();
+
+        // only counted down now, so popState cannot mistake a state in flight for the end of the history
+        mDecodableCount--;
+        if (valid)
+        {
+            mDecoded.push_back(std::move(decoded));
+        }
+        else
+        {
+            // nothing older can be trusted either
+            mDecodableCount = 0;
+        }
+        mCondition.notify_all();
+    }
+}
+
+bool RewindBuffer::decodeEntry(const Entry& entry, const Entry& keyframe, std::vector<uint8_t>& state)
+{
+    state.resize(entry.stateSize);
+    if (mZeroState.size() < entry.stateSize) return false;
+
+    if (entry.id == keyframe.id)
+    {
+        return decodeDifference(mStorage.data() + entry.offset, entry.size, mZeroState.data(), state.data(), state.size());
+    }
+
+    // consecutive states mostly share their keyframe
+    if (mCachedKeyframeId != keyframe.id)
+    {
+        mCachedKeyframe.resize(keyframe.stateSize);
+        if (!decodeDifference(mStorage.data() + keyframe.offset, keyframe.size, mZeroState.data(), mCachedKeyframe.data(), mCachedKeyframe.size()))
+        {
+            mCachedKeyframeId = UINT64_MAX;
+            return false;
+        }
+        mCachedKeyframeId = keyframe.id;
+    }
+
+    if (mCachedKeyframe.size() != entry.stateSize) return false;
+    return decodeDifference(mStorage.data() + entry.offset, entry.size, mCachedKeyframe.data(), state.data(), state.size());
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*  @ingroup SaveState
+
+    the rewind history: one machine state per frame in a ring of fixed size.
+    Every keyframeInterval-th state is a keyframe; all others are stored as the difference to their keyframe.
+    Both are XORed (keyframes against zeros), and runs of zero bytes are left out, so a frame costs about as
+    many bytes as the machine changed since its keyframe. Any state decodes from its keyframe alone.
+    When the ring is full, the oldest keyframe goes together with its deltas.
+    While rewinding, a background thread decodes the next older states ahead of time; no states can be
+    pushed meanwhile.
+*/
+
+class RewindBuffer
+{
+public:
+    RewindBuffer() = default;
+    ~RewindBuffer();
+
+    static constexpr uint16_t keyframeInterval = 60;
+    static constexpr uint8_t prefetchDepth = 8;
+
+    // drops the history. 0 disables rewinding
+    void setCapacity(const size_t bytes);
+    size_t capacity() const { return mStorage.size(); }
+
+    // emulation thread; ignored while rewinding
+    void push(const std::vector<uint8_t>& state);
+
+    void beginRewind();
+
+    // emulation thread. Removes the newest state from the history and returns it; false once it is used up
+    bool popState(std::vector<uint8_t>& state);
+
+    void endRewind();
+
+    void clear();
+
+    size_t stateCount() const;
+    size_t usedBytes() const;
+
+private:
+    struct Entry
+    {
+        uint64_t id {};
+        uint64_t keyframeId {};
+        size_t offset {};
+        uint32_t size {};
+        uint32_t stateSize {};
+    };
+
+    struct DecodedState
+    {
+        uint64_t id {};
+        std::vector<uint8_t> data;
+    };
+
+    bool store(const bool keyframe, const size_t stateSize);
+    const Entry* findEntry(const uint64_t id) const;
+    void dropOldest();
+
+    void decodeLoop();
+    bool decodeEntry(const Entry& entry, const Entry& keyframe, std::vector<uint8_t>& state);
+
+    std::vector<uint8_t> mStorage;
+    size_t mWritePosition {};
+    size_t mUsedBytes {};
+
+    // guarded by mMutex while rewinding
+    std::deque<Entry> mEntries;
+    uint64_t mNextId {};
+
+    // emulation thread; the keyframe the following deltas refer to
+    std::vector<uint8_t> mKeyframeState;
+    std::vector<uint8_t> mEncoded;
+    std::vector<uint8_t> mZeroState; // what keyframes are XORed with
+    uint64_t mKeyframeId {};
+    uint16_t mFramesSinceKeyframe { keyframeInterval };
+
+    // background decoding
+    bool mRewinding {};
+    bool mStopDecoding {};
+    uint64_t mDecodeCursor {}; // id of the next state to decode
+    size_t mDecodableCount {}; // states left for the decoder
+    std::deque<DecodedState> mDecoded;
+    std::vector<std::vector<uint8_t>> mFreeBuffers;
+
+    // decoder thread only
+    std::vector<uint8_t> mCachedKeyframe;
+    uint64_t mCachedKeyframeId { UINT64_MAX };
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::thread mDecoder;
+};
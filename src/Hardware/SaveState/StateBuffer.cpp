@@ -0,0 +1,51 @@
+#include "StateBuffer.h"
+
+#include <cstring>
+
+StateWriter::StateWriter(std::vector<uint8_t>& buffer)
+    : mBuffer(buffer)
+{
+    mBuffer.clear();
+}
+
+void StateWriter::writeBytes(const void* data, const size_t size)
+{
+    mLayout = addStateField(mLayout, stateBytesCode);
+    appendBytes(data, size);
+}
+
+void StateWriter::appendBytes(const void* data, const size_t size)
+{
+    if (size == 0) return;
+
+    const size_t position = mBuffer.size();
+    mBuffer.resize(position + size);
+    std::memcpy(mBuffer.data() + position, data, size);
+}
+
+StateReader::StateReader(const uint8_t* data, const size_t size)
+    : mData(data),
+      mSize(size)
+{}
+
+void StateReader::readBytes(void* data, const size_t size)
+{
+    mLayout = addStateField(mLayout, stateBytesCode);
+    takeBytes(data, size);
+}
+
+void StateReader::takeBytes(void* data, const size_t size)
+{
+    if (size == 0) return;
+
+    if (size > mSize - mPosition)
+    {
+        std::memset(data, 0, size);
+        mPosition = mSize;
+        mFailed = true;
+        return;
+    }
+
+    std::memcpy(data, mData + mPosition, size);
+    mPosition += size;
+}
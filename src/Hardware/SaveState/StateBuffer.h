@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+/*  @ingroup SaveState
+
+    serialization of the machine state into one contiguous byte buffer.
+    Every component writes its fields in a fixed order and reads them back in the same order. Fields are copied
+    as they are in memory, so a state only fits the build that wrote it. The writer reuses the capacity of its
+    buffer; once it has grown to the size of a state, saving allocates nothing.
+    Writer and reader both fold the size and kind of every field into a layout fingerprint. A state written by a
+    build that saves different fields, in a different order or with other types, reads back with a fingerprint
+    that does not match the one it was written with. Structures written as a whole only count with their size.
+*/
+
+// the size of a field and what kind of value it holds; byte blocks of any size count alike
+template <typename T>
+constexpr uint32_t stateFieldCode()
+{
+    uint32_t kind = 5;
+    if (std::is_same<T, bool>::value) kind = 0;
+    else if (std::is_enum<T>::value) kind = 1;
+    else if (std::is_floating_point<T>::value) kind = 2;
+    else if (std::is_signed<T>::value) kind = 3;
+    else if (std::is_unsigned<T>::value) kind = 4;
+
+    return static_cast<uint32_t>(sizeof(T)) << 3 | kind;
+}
+
+static constexpr uint32_t stateBytesCode = 7;
+
+// FNV-1a over the field codes
+static constexpr uint32_t stateLayoutStart = 0x811C9DC5;
+constexpr uint32_t addStateField(const uint32_t layout, const uint32_t code)
+{
+    return (layout ^ code) * 0x01000193;
+}
+
+class StateWriter
+{
+public:
+    // starts over at the beginning of the buffer
+    explicit StateWriter(std::vector<uint8_t>& buffer);
+    ~StateWriter() = default;
+
+    template <typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain data can be written directly");
+        mLayout = addStateField(mLayout, stateFieldCode<T>());
+        appendBytes(&value, sizeof(T));
+    }
+
+    void writeBytes(const void* data, const size_t size);
+
+    size_t size() const { return mBuffer.size(); }
+    uint32_t layout() const { return mLayout; }
+
+private:
+    void appendBytes(const void* data, const size_t size);
+
+    std::vector<uint8_t>& mBuffer;
+    uint32_t mLayout { stateLayoutStart };
+};
+
+class StateReader
+{
+public:
+    StateReader(const uint8_t* data, const size_t size);
+    ~StateReader() = default;
+
+    template <typename T>
+    void read(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "only plain data can be read directly");
+        mLayout = addStateField(mLayout, stateFieldCode<T>());
+        takeBytes(&value, sizeof(T));
+    }
+
+    // reading past the end fills the remaining bytes with zeros and marks the reader as failed
+    void readBytes(void* data, const size_t size);
+
+    // for components that find the data they read inconsistent
+    void fail() { mFailed = true; }
+
+    bool failed() const { return mFailed; }
+    size_t remaining() const { return mSize - mPosition; }
+    uint32_t layout() const { return mLayout; }
+
+private:
+    void takeBytes(void* data, const size_t size);
+
+    const uint8_t* mData {};
+    size_t mSize {};
+    size_t mPosition {};
+
+    uint32_t mLayout { stateLayoutStart };
+    bool mFailed {};
+};
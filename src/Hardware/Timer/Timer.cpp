@@ -0,0 +1,161 @@
+#include "Timer.h"
+
+#include "../Memory/MemoryDefines.h"
+#include "../SaveState/StateBuffer.h"
+
+// the falling edges of the divider bit TAC selects are 2^shift cycles apart (4096, 262144, 65536, 16384 Hz)
+static constexpr uint8_t gEdgeShifts[] = { 10, 4, 6, 8 };
+static constexpr uint8_t gEnableBit = 0b100;
+static constexpr uint8_t gControlMask = 0b111;
+static constexpr uint8_t gUnusedControlBits = 0b11111000;
+
+uint8_t Timer::readRegister(const uint16_t address, const uint64_t now) const
+{
+    switch (address)
+    {
+        case dividerRegister: return static_cast<uint8_t>(divider(now) >> 8);
+        case timerCounterRegister: return mCounter;
+        case timerModuloRegister: return mModulo;
+        case timerControlRegister: return gUnusedControlBits | mControl;
+        default: return 0xFF;
+    }
+}
+
+bool Timer::writeRegister(const uint16_t address, const uint8_t value, const uint64_t now)
+{
+    bool overflowed = update(now);
+
+    switch (address)
+    {
+        case dividerRegister:
+        {
+            // any write clears the divider; if that makes the selected bit fall, TIMA counts it
+            if (counterInput(now)) overflowed |= incrementCounter();
+            mDividerStart = now;
+            break;
+        }
+        case timerCounterRegister:
+        {
+            // TODO writes during the cycle after an overflow cancel the reload on hardware
+            mCounter = value;
+            break;
+        }
+        case timerModuloRegister:
+        {
+            mModulo = value;
+            break;
+        }
+        case timerControlRegister:
+        {
+            // switching the input from a set bit to a cleared one (or off) is a falling edge as well
+            const bool input = counterInput(now);
+            mControl = value & gControlMask;
+            if (input && counterInput(now) == false) overflowed |= incrementCounter();
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    scheduleOverflow(now);
+    return overflowed;
+}
+
+bool Timer::update(const uint64_t now)
+{
+    bool overflowed = false;
+
+    if (enabled())
+    {
+        const uint8_t shift = edgeShift();
+        uint64_t edges = (divider(now) >> shift) - (divider(mCounterTime) >> shift);
+
+        const uint64_t edgesToOverflow = 0x100 - mCounter;
+        if (edges >= edgesToOverflow)
+        {
+            // TODO the reload from TMA happens one machine cycle after the overflow on hardware
+            edges -= edgesToOverflow;
+            mCounter = static_cast<uint8_t>(mModulo + edges % (0x100 - mModulo));
+            overflowed = true;
+        }
+        else
+        {
+            mCounter += static_cast<uint8_t>(edges);
+        }
+    }
+
+    mCounterTime = now;
+    if (overflowed) scheduleOverflow(now);
+
+    return overflowed;
+}
+
+void Timer::reset(const uint64_t now)
+{
+    mDividerStart = now;
+    mCounterTime = now;
+    mOverflowCycle = noEvent;
+
+    mCounter = 0;
+    mModulo = 0;
+    mControl = 0;
+}
+
+void Timer::saveState(StateWriter& writer) const
+{
+    writer.write(mDividerStart);
+    writer.write(mCounterTime);
+    writer.write(mOverflowCycle);
+    writer.write(mCounter);
+    writer.write(mModulo);
+    writer.write(mControl);
+}
+
+void Timer::loadState(StateReader& reader)
+{
+    reader.read(mDividerStart);
+    reader.read(mCounterTime);
+    reader.read(mOverflowCycle);
+    reader.read(mCounter);
+    reader.read(mModulo);
+    reader.read(mControl);
+}
+
+bool Timer::enabled() const
+{
+    return (mControl & gEnableBit) != 0;
+}
+
+uint8_t Timer::edgeShift() const
+{
+    return gEdgeShifts[mControl & 0b11];
+}
+
+bool Timer::counterInput(const uint64_t now) const
+{
+    return enabled() && ((divider(now) >> (edgeShift() - 1)) & 0b1);
+}
+
+bool Timer::incrementCounter()
+{
+    if (++mCounter != 0) return false;
+
+    mCounter = mModulo;
+    return true;
+}
+
+void Timer::scheduleOverflow(const uint64_t now)
+{
+    if (enabled() == false)
+    {
+        mOverflowCycle = noEvent;
+        return;
+    }
+
+    // the edge that takes TIMA past 0xFF, counted like in update()
+    const uint8_t shift = edgeShift();
+    const uint64_t overflowEdge = (divider(now) >> shift) + (0x100 - mCounter);
+    mOverflowCycle = mDividerStart + (overflowEdge << shift);
+}
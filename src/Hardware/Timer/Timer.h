@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+class StateReader;
+class StateWriter;
+
+/*  @ingroup Timer
+
+    the divider and the timer (DIV, TIMA, TMA, TAC, 0xFF04 - 0xFF07).
+    Nothing is counted while the machine runs. DIV is the upper byte of a 16-bit divider that is derived from
+    the machine clock and the cycle it was last reset at. TIMA counts the falling edges of the divider bit
+    selected by TAC; its value is brought up to date only when it is accessed, and the cycle of its next
+    overflow is handed to the caller as a single event. Writes to DIV and TAC that make the selected bit fall
+    increment TIMA, as on hardware; that is checked when the write happens.
+    All times are machine clock cycles (T-cycles since power-on).
+*/
+
+class Timer
+{
+public:
+    Timer() = default;
+    ~Timer() = default;
+
+    static constexpr uint64_t noEvent = std::numeric_limits<uint64_t>::max();
+
+    // TIMA is only current after update(now)
+    uint8_t readRegister(const uint16_t address, const uint64_t now) const;
+
+    // returns true if the timer interrupt has to be requested
+    bool writeRegister(const uint16_t address, const uint8_t value, const uint64_t now);
+
+    // the cycle at which TIMA overflows next, or noEvent while the timer is stopped
+    uint64_t nextEvent() const { return mOverflowCycle; }
+
+    // brings TIMA up to now; returns true if it overflowed meanwhile, i.e. the timer interrupt has to be requested
+    bool update(const uint64_t now);
+
+    // stops the timer and starts the divider at now
+    void reset(const uint64_t now);
+
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
+
+private:
+    bool enabled() const;
+    uint8_t edgeShift() const;
+    uint64_t divider(const uint64_t now) const { return now - mDividerStart; }
+
+    // the input TIMA counts the falling edges of: the selected divider bit while the timer is enabled
+    bool counterInput(const uint64_t now) const;
+
+    // one TIMA step outside of the regular edges; returns true on overflow
+    bool incrementCounter();
+    void scheduleOverflow(const uint64_t now);
+
+    uint64_t mDividerStart {}; // the cycle the divider was last reset at
+    uint64_t mCounterTime {}; // TIMA holds mCounter as of this cycle
+    uint64_t mOverflowCycle { noEvent };
+
+    uint8_t mCounter {}; // TIMA
+    uint8_t mModulo {}; // TMA
+    uint8_t mControl {}; // TAC
+};
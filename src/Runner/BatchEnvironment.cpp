@@ -0,0 +1,149 @@
+#include "BatchEnvironment.h"
+
+#include <cstring>
+
+static constexpr size_t gPixelsPerFrame = gDisplayWidth * gDisplayHeight;
+
+BatchEnvironment::BatchEnvironment(const Config& config)
+    : mConfig(config),
+      mPool(config.threadCount)
+{
+    mSnapshot.memory().setColorConversion(ColorTable::PixelFormat::argb8888, ColorTable::ColorCorrection::none);
+    mSnapshot.apu().setSynthesisEnabled(false);
+
+    for (size_t index = 0; index < mConfig.environmentCount; index++)
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->memory().setColorConversion(ColorTable::PixelFormat::argb8888, ColorTable::ColorCorrection::none);
+        mMachines.push_back(std::move(machine));
+    }
+
+    const size_t observationBytes = mMachines.size() * observationSize();
+    mObservedMemory.assign(observationBytes, 0);
+    mPreviousMemory.assign(observationBytes, 0);
+    mEpisodeDone.assign(mMachines.size(), 0);
+
+    mStepTask = [this](const size_t index) { stepEnvironment(index); };
+
+    resetAll();
+}
+
+bool BatchEnvironment::loadRom(const std::string& fileName)
+{
+    std::shared_ptr<const Machine::Rom> rom = Machine::readRom(fileName);
+    if (!rom) return false;
+
+    // booting only happens once; every episode starts from where it ended
+    mSnapshot.setRom(std::move(rom));
+    mSnapshot.ppu().setFrameSkipping(true);
+    for (uint32_t frame = 0; frame < mConfig.bootFrames; frame++)
+    {
+        mSnapshot.runFrame();
+    }
+
+    resetAll();
+    return true;
+}
+
+void BatchEnvironment::setRewardFunction(RewardFunction rewardFunction)
+{
+    mRewardFunction = std::move(rewardFunction);
+}
+
+void BatchEnvironment::bindObservations(const Observations& observations)
+{
+    mObservations = observations;
+
+    if (mObservations.frames)
+    {
+        // the PPU draws right into the caller's array. A single buffer id is enough, as every frame goes there
+        for (size_t index = 0; index < mMachines.size(); index++)
+        {
+            DisplayData* frame = reinterpret_cast<DisplayData*>(mObservations.frames + index * gPixelsPerFrame);
+            mMachines[index]->ppu().setDisplayBuffer(*frame, 0);
+        }
+    }
+
+    // the line cache knows nothing about the new arrays; forking invalidates it
+    resetAll();
+}
+
+void BatchEnvironment::reset(const size_t index)
+{
+    Machine& machine = *mMachines[index];
+    machine.forkFrom(mSnapshot);
+
+    const size_t size = observationSize();
+    uint8_t* current = mObservations.memory ? mObservations.memory + index * size : mObservedMemory.data() + index * size;
+    observeMemory(index, current);
+
+    mEpisodeDone[index] = 0;
+    if (mObservations.done) mObservations.done[index] = 0;
+    if (mObservations.rewards) mObservations.rewards[index] = 0.0f;
+}
+
+void BatchEnvironment::resetAll()
+{
+    for (size_t index = 0; index < mMachines.size(); index++)
+    {
+        reset(index);
+    }
+}
+
+void BatchEnvironment::step(const uint8_t* actions)
+{
+    mActions = actions;
+    mPool.run(mMachines.size(), mStepTask);
+    mActions = nullptr;
+
+    mStepCount += mMachines.size();
+}
+
+void BatchEnvironment::stepEnvironment(const size_t index)
+{
+    if (mEpisodeDone[index]) reset(index);
+
+    Machine& machine = *mMachines[index];
+    Ppu& ppu = machine.ppu();
+
+    // the buttons change at the start of the step and stay pressed for all of its frames
+    const Machine::ButtonChange change { 0, mActions[index] };
+    for (uint32_t frame = 0; frame < mConfig.framesPerStep; frame++)
+    {
+        const bool lastFrame = frame + 1 == mConfig.framesPerStep;
+        ppu.setFrameSkipping(lastFrame == false || mObservations.frames == nullptr);
+
+        if (frame == 0)
+        {
+            machine.runFrame(&change, 1);
+        }
+        else
+        {
+            machine.runFrame();
+        }
+    }
+
+    const size_t size = observationSize();
+    uint8_t* previous = mPreviousMemory.data() + index * size;
+    uint8_t* current = mObservations.memory ? mObservations.memory + index * size : mObservedMemory.data() + index * size;
+    if (size > 0) std::memcpy(previous, current, size);
+    observeMemory(index, current);
+
+    bool done = false;
+    const float reward = mRewardFunction ? mRewardFunction(previous, current, done) : 0.0f;
+
+    mEpisodeDone[index] = done ? 1 : 0;
+    if (mObservations.rewards) mObservations.rewards[index] = reward;
+    if (mObservations.done) mObservations.done[index] = mEpisodeDone[index];
+}
+
+void BatchEnvironment::observeMemory(const size_t index, uint8_t* target)
+{
+    MemoryManager& memory = mMachines[index]->memory();
+
+    const std::vector<uint16_t>& addresses = mConfig.observedAddresses;
+    for (size_t offset = 0; offset < addresses.size(); offset++)
+    {
+        target[offset] = memory.getMemoryAtAddress(addresses[offset]);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "WorkStealingPool.h"
+#include "../Hardware/Machine/Machine.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*  @ingroup Runner
+
+    a batch of machines driven step by step, as a reinforcement learning environment.
+    Observations go straight into arrays the caller owns: the PPU draws into the caller's frame array, and the
+    observed memory bytes, rewards and episode ends are written next to it. A step allocates nothing.
+    Every episode starts from a snapshot taken once after booting; a reset is a copy-on-write fork of it.
+    Environments whose episode ended are reset at the start of the next step, before the action is applied.
+*/
+
+class BatchEnvironment
+{
+public:
+    // gets the observed bytes before and after a step; returns the reward and sets done to end the episode.
+    // Called from the pool's threads, for different environments at the same time
+    using RewardFunction = std::function<float(const uint8_t* previous, const uint8_t* current, bool& done)>;
+
+    struct Config
+    {
+        size_t environmentCount { 1 };
+        size_t threadCount {}; // 0: one per physical core
+        uint32_t framesPerStep { 1 }; // the action is held for all of them; only the last one is drawn
+        uint32_t bootFrames {}; // run once before the snapshot is taken
+        std::vector<uint16_t> observedAddresses; // bytes of the memory map copied into every observation
+    };
+
+    // caller-owned arrays with one entry per environment, back to back. Any of them may be nullptr
+    struct Observations
+    {
+        uint32_t* frames {}; // gDisplayWidth * gDisplayHeight ARGB pixels each; not to be written by the caller
+        uint8_t* memory {}; // observedAddresses.size() bytes each
+        float* rewards {};
+        uint8_t* done {};
+    };
+
+    explicit BatchEnvironment(const Config& config);
+    ~BatchEnvironment() = default;
+
+    // boots a machine with the ROM and takes the snapshot every episode starts from. Returns false if the ROM
+    // cannot be read
+    bool loadRom(const std::string& fileName);
+
+    void setRewardFunction(RewardFunction rewardFunction);
+
+    // the arrays have to stay valid until other ones are bound; resets every environment
+    void bindObservations(const Observations& observations);
+
+    // starts a new episode in the given environment
+    void reset(const size_t index);
+    void resetAll();
+
+    // one button mask (see Joypad::Button) per environment
+    void step(const uint8_t* actions);
+
+    size_t environmentCount() const { return mMachines.size(); }
+    size_t observationSize() const { return mConfig.observedAddresses.size(); }
+    uint64_t stepCount() const { return mStepCount; } // summed up over all environments
+
+    Machine& machine(const size_t index) { return *mMachines[index]; }
+
+private:
+    void stepEnvironment(const size_t index);
+    void observeMemory(const size_t index, uint8_t* target);
+
+    Config mConfig;
+
+    Machine mSnapshot;
+    std::vector<std::unique_ptr<Machine>> mMachines;
+
+    RewardFunction mRewardFunction;
+    Observations mObservations {};
+    std::vector<uint8_t> mObservedMemory; // the latest observed bytes of every environment
+    std::vector<uint8_t> mPreviousMemory;
+    std::vector<uint8_t> mEpisodeDone;
+
+    const uint8_t* mActions {}; // the current step's
+    uint64_t mStepCount {};
+
+    WorkStealingPool mPool;
+    WorkStealingPool::Task mStepTask;
+};
@@ -0,0 +1,63 @@
+#include "MachineRunner.h"
+
+MachineRunner::MachineRunner(const size_t machineCount, const size_t threadCount)
+    : mPool(threadCount)
+{
+    for (size_t index = 0; index < machineCount; index++)
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->memory().setColorConversion(ColorTable::PixelFormat::argb8888, ColorTable::ColorCorrection::none);
+        machine->apu().setSynthesisEnabled(false);
+        machine->ppu().setFrameSkipping(true);
+
+        mMachines.push_back(std::move(machine));
+    }
+}
+
+double MachineRunner::Statistics::framesPerSecond() const
+{
+    if (duration.count() <= 0) return 0.0;
+    return static_cast<double>(frames) * 1e9 / static_cast<double>(duration.count());
+}
+
+bool MachineRunner::loadRom(const std::string& fileName)
+{
+    std::shared_ptr<const Machine::Rom> rom = Machine::readRom(fileName);
+    if (!rom) return false;
+
+    for (std::unique_ptr<Machine>& machine : mMachines)
+    {
+        machine->setRom(rom);
+    }
+    return true;
+}
+
+void MachineRunner::setDrawing(const bool enabled)
+{
+    mDisplayData.assign(enabled ? mMachines.size() : 0, DisplayData {});
+
+    for (size_t index = 0; index < mMachines.size(); index++)
+    {
+        Ppu& ppu = mMachines[index]->ppu();
+        if (enabled) ppu.setDisplayBuffer(mDisplayData[index], 0);
+        ppu.setFrameSkipping(enabled == false);
+    }
+}
+
+MachineRunner::Statistics MachineRunner::run(const uint64_t frameCount, const std::atomic<bool>* stop)
+{
+    Statistics statistics {};
+    const auto start = std::chrono::steady_clock::now();
+
+    const WorkStealingPool::Task runFrame = [this](const size_t index) { mMachines[index]->runFrame(); };
+    for (uint64_t frame = 0; frame < frameCount; frame++)
+    {
+        if (stop && *stop) break;
+
+        mPool.run(mMachines.size(), runFrame);
+        statistics.frames += mMachines.size();
+    }
+
+    statistics.duration = std::chrono::steady_clock::now() - start;
+    return statistics;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "WorkStealingPool.h"
+#include "../Application/ApplicationDefines.h"
+#include "../Hardware/Machine/Machine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*  @ingroup Runner
+
+    any amount of independent machines running the same ROM as fast as the host allows, e.g. for test runs or
+    training. The machines share the ROM and the colour tables; everything else belongs to one machine alone,
+    so they can run on different threads without any synchronisation. Every frame of every machine is one
+    task for the pool, and a frame ends for all machines before the next one starts.
+    There is no sound; the picture is only drawn when asked for.
+*/
+
+class MachineRunner
+{
+public:
+    // 0 threads: one per physical core
+    explicit MachineRunner(const size_t machineCount, const size_t threadCount = 0);
+    ~MachineRunner() = default;
+
+    struct Statistics
+    {
+        uint64_t frames {}; // summed up over all machines
+        std::chrono::nanoseconds duration {};
+
+        double framesPerSecond() const;
+    };
+
+    // reads the ROM once for all machines; returns false if it cannot be read
+    bool loadRom(const std::string& fileName);
+
+    // every machine gets its own display buffer while drawing
+    void setDrawing(const bool enabled);
+
+    // runs every machine for the given amount of frames. Stops early after a frame in which stop became true
+    Statistics run(const uint64_t frameCount, const std::atomic<bool>* stop = nullptr);
+
+    size_t machineCount() const { return mMachines.size(); }
+    size_t threadCount() const { return mPool.threadCount(); }
+
+    Machine& machine(const size_t index) { return *mMachines[index]; }
+    const DisplayData& displayData(const size_t index) const { return mDisplayData[index]; }
+
+private:
+    std::vector<std::unique_ptr<Machine>> mMachines;
+    std::vector<DisplayData> mDisplayData; // empty unless drawing
+
+    WorkStealingPool mPool;
+};
@@ -0,0 +1,182 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static bool readTopologyValue(const uint32_t cpu, const char* name, int32_t& value)
+{
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    return static_cast<bool>(file >> value);
+}
+
+static void pinToCore(const int32_t core)
+{
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(core, &cpuSet);
+
+    // without the permission the thread simply floats
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#else
+    (void) core;
+#endif
+}
+
+WorkStealingPool::WorkStealingPool(const size_t threadCount)
+{
+    const std::vector<uint32_t> cores = physicalCores();
+    const size_t count = threadCount > 0 ? threadCount : cores.size();
+
+    for (size_t index = 0; index < count; index++)
+    {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+
+    // more threads than cores are not pinned; they would only fight over the same core
+    for (size_t index = 0; index < count; index++)
+    {
+        const int32_t core = count <= cores.size() ? static_cast<int32_t>(cores[index]) : -1;
+        mThreads.emplace_back(&WorkStealingPool::workerLoop, this, index, core);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWorkCondition.notify_all();
+
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::run(const size_t count, const Task& task)
+{
+    if (count == 0) return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    // a worker still looking for work from the previous batch may pick up a task as soon as it is queued
+    mRemaining = count;
+
+    // consecutive indices stay together, so neighbouring tasks tend to run on the same core
+    const size_t workerCount = mWorkers.size();
+    for (size_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+    {
+        Worker& worker = *mWorkers[workerIndex];
+        std::lock_guard<std::mutex> workerLock(worker.mutex);
+
+        const size_t begin = count * workerIndex / workerCount;
+        const size_t end = count * (workerIndex + 1) / workerCount;
+
+        worker.tasks.resize(end - begin);
+        for (size_t index = begin; index < end; index++)
+        {
+            // the owner works from the back; start it on the lowest index
+            worker.tasks[end - 1 - index] = static_cast<uint32_t>(index);
+        }
+        worker.head = 0;
+        worker.tail = worker.tasks.size();
+        worker.task = &task;
+    }
+
+    mGeneration++;
+    mWorkCondition.notify_all();
+
+    mDoneCondition.wait(lock, [this] { return mRemaining == 0; });
+}
+
+std::vector<uint32_t> WorkStealingPool::physicalCores()
+{
+    const uint32_t logicalCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<uint32_t> cores;
+    std::set<std::pair<int32_t, int32_t>> seenCores; // (package, core)
+    for (uint32_t cpu = 0; cpu < logicalCount; cpu++)
+    {
+        int32_t package = 0;
+        int32_t core = 0;
+        if (!readTopologyValue(cpu, "physical_package_id", package) || !readTopologyValue(cpu, "core_id", core))
+        {
+            // no topology to go by; every logical CPU counts
+            core = static_cast<int32_t>(cpu);
+        }
+
+        // hyperthreading siblings share a core, and with it its caches and execution units
+        if (seenCores.insert({ package, core }).second) cores.push_back(cpu);
+    }
+
+    return cores;
+}
+
+void WorkStealingPool::workerLoop(const size_t workerIndex, const int32_t core)
+{
+    if (core >= 0) pinToCore(core);
+
+    uint64_t generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkCondition.wait(lock, [this, generation] { return mStop || mGeneration != generation; });
+            if (mStop) return;
+
+            generation = mGeneration;
+        }
+
+        const Task* task = nullptr;
+        uint32_t index = 0;
+        while (takeTask(workerIndex, task, index) || stealTask(workerIndex, task, index))
+        {
+            (*task)(index);
+
+            if (--mRemaining == 0)
+            {
+                // taking the lock keeps the notification from slipping in before run() waits
+                std::lock_guard<std::mutex> lock(mMutex);
+                mDoneCondition.notify_all();
+            }
+        }
+    }
+}
+
+bool WorkStealingPool::takeTask(const size_t workerIndex, const Task*& task, uint32_t& index)
+{
+    Worker& worker = *mWorkers[workerIndex];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.head == worker.tail) return false;
+
+    task = worker.task;
+    index = worker.tasks[--worker.tail];
+    return true;
+}
+
+bool WorkStealingPool::stealTask(const size_t workerIndex, const Task*& task, uint32_t& index)
+{
+    const size_t workerCount = mWorkers.size();
+    for (size_t offset = 1; offset < workerCount; offset++)
+    {
+        Worker& victim = *mWorkers[(workerIndex + offset) % workerCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.head == victim.tail) continue;
+
+        task = victim.task;
+        index = victim.tasks[victim.head++];
+        return true;
+    }
+
+    return false;
+}
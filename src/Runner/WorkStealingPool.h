@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*  @ingroup Runner
+
+    a fixed set of worker threads, each pinned to its own physical core where the platform allows it.
+    Work comes in batches of numbered tasks. They get dealt out evenly across the workers up front; a worker
+    takes its own tasks from the back of its queue and, once it runs dry, steals from the front of the others.
+    Tasks of unequal length (a machine busy with a lot of LCD work next to one waiting for VBlank) balance out
+    that way without a shared queue every task has to go through.
+*/
+
+class WorkStealingPool
+{
+public:
+    // 0 threads: one per physical core
+    explicit WorkStealingPool(const size_t threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    using Task = std::function<void(size_t)>;
+
+    size_t threadCount() const { return mThreads.size(); }
+
+    // calls task(index) once for every index below count and returns when all of them are done.
+    // Only one batch runs at a time; task has to be safe to call from several threads at once
+    void run(const size_t count, const Task& task);
+
+    // the first logical CPU of every physical core
+    static std::vector<uint32_t> physicalCores();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        const Task* task {}; // handed out together with the indices, so a late thief cannot mix up batches
+        std::vector<uint32_t> tasks;
+        size_t head {}; // stolen from here
+        size_t tail {}; // taken by the owner from here
+    };
+
+    void workerLoop(const size_t workerIndex, const int32_t core);
+    bool takeTask(const size_t workerIndex, const Task*& task, uint32_t& index);
+    bool stealTask(const size_t workerIndex, const Task*& task, uint32_t& index);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::vector<std::thread> mThreads;
+
+    std::atomic<size_t> mRemaining {}; // tasks of the current batch
+    uint64_t mGeneration {};
+    bool mStop {};
+
+    std::mutex mMutex;
+    std::condition_variable mWorkCondition;
+    std::condition_variable mDoneCondition;
+};
@@ -1,26 +1,177 @@
 #include "Application/Application.h"
 
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <cstdlib>
-#include <thread>
+#include <string>
 
-bool gTerminate = false;
+// set from the signal handler; lock-free atomics are safe to use there. Only this front end knows about it
+static std::atomic<bool> gTerminate { false };
+
+// far beyond any screen; bigger textures would not be accepted by the renderer anyway
+static constexpr int gMaxScale = 16;
+
+static void requestTermination(int)
+{
+    gTerminate = true;
+}
+
+/*  usage: BoyColorGame <rom> [options]
+        --headless          no window; runs at unlimited speed unless --speed is given
+        --stream <file>     writes every frame to file ("-" for stdout); .y4m files get a Y4M header, anything else raw RGB
+        --dedup             leaves repeated frames out of the stream and writes the times of the others to
+                            <file>.timestamps (mkvmerge timestamp format v2); not for stdout
+        --frames <count>    stops after the given amount of frames
+        --speed <n>         runs at n times the hardware speed; 0 means unlimited
+        --run-ahead <n>     shows the frame n frames ahead to hide the game's own input lag
+        --rewind <MB>       memory for the rewind history; 32 MB with a window, none when headless
+        --record <file>     records the input into a movie
+        --play <file>       replays a movie, then continues with live input
+        --seek <frame>      starts the movie replay at the given frame
+        --boot-rom <file>   runs a DMG or GBC boot ROM first; by default the game starts right after it
+        --color-correction  shows the colours as they looked on the GBC screen instead of at full saturation
+        --scale <n>         upscales the frames n times (up to 16) on the CPU before presenting them
+        --filter <name>     the filter for --scale: nearest (default), scanline or edge
+*/
 
 int main(int argc, char** argv)
 {
-    if (argc != 2) return EXIT_FAILURE;
+    if (argc < 2) return EXIT_FAILURE;
+
+    const std::string gamePath = argv[1];
+
+    bool headless = false;
+    bool skipDuplicates = false;
+    std::string streamPath;
+    uint64_t frameLimit = 0;
+    int speed = -1;
+    int runAhead = 0;
+    int rewindMegabytes = -1;
+    std::string recordPath;
+    std::string playPath;
+    uint64_t seekFrame = 0;
+    std::string bootRomPath;
+    bool colorCorrection = false;
+    int scale = 1;
+    FrameScaler::Filter filter = FrameScaler::Filter::nearest;
 
-    Application application;
-    
-    while (!gTerminate)
+    for (int index = 2; index < argc; index++)
     {
-        application.loop();
+        const std::string option = argv[index];
+        const bool hasValue = index + 1 < argc;
+
+        if (option == "--headless")
+        {
+            headless = true;
+        }
+        else if (option == "--color-correction")
+        {
+            colorCorrection = true;
+        }
+        else if (option == "--scale" && hasValue)
+        {
+            scale = std::atoi(argv[++index]);
+        }
+        else if (option == "--filter" && hasValue)
+        {
+            const std::string name = argv[++index];
+            if (name == "nearest") filter = FrameScaler::Filter::nearest;
+            else if (name == "scanline") filter = FrameScaler::Filter::scanlines;
+            else if (name == "edge") filter = FrameScaler::Filter::edge_aware;
+            else return EXIT_FAILURE;
+        }
+        else if (option == "--dedup")
+        {
+            skipDuplicates = true;
+        }
+        else if (option == "--stream" && hasValue)
+        {
+            streamPath = argv[++index];
+        }
+        else if (option == "--frames" && hasValue)
+        {
+            frameLimit = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (option == "--speed" && hasValue)
+        {
+            speed = std::atoi(argv[++index]);
+        }
+        else if (option == "--record" && hasValue)
+        {
+            recordPath = argv[++index];
+        }
+        else if (option == "--play" && hasValue)
+        {
+            playPath = argv[++index];
+        }
+        else if (option == "--seek" && hasValue)
+        {
+            seekFrame = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (option == "--rewind" && hasValue)
+        {
+            rewindMegabytes = std::atoi(argv[++index]);
+        }
+        else if (option == "--boot-rom" && hasValue)
+        {
+            bootRomPath = argv[++index];
+        }
+        else if (option == "--run-ahead" && hasValue)
+        {
+            runAhead = std::atoi(argv[++index]);
+        }
+        else
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Ctrl+C ends headless runs cleanly, so streams get completed
+    std::signal(SIGINT, requestTermination);
+    std::signal(SIGTERM, requestTermination);
+
+    Application application(headless);
+
+    if (streamPath.empty() == false)
+    {
+        const bool y4m = streamPath.size() >= 4 && streamPath.compare(streamPath.size() - 4, 4, ".y4m") == 0;
+        if (!application.openFrameStream(streamPath, y4m ? FrameStreamer::Format::y4m : FrameStreamer::Format::raw_rgb, skipDuplicates))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (speed < 0) speed = headless ? 0 : 1;
+    if (speed == 0)
+    {
+        application.setSpeed(FramePacer::SpeedMode::unlimited);
+    }
+    else if (speed > 1)
+    {
+        application.setSpeed(FramePacer::SpeedMode::multiplied, static_cast<uint8_t>(std::min(speed, 255)));
     }
 
-    if (false) // TODO game loaded
+    application.setFrameLimit(frameLimit);
+    application.setRunAhead(static_cast<uint8_t>(std::clamp(runAhead, 0, 255)));
+
+    if (rewindMegabytes < 0) rewindMegabytes = headless ? 0 : 32;
+    application.setRewindCapacity(static_cast<size_t>(rewindMegabytes) << 20);
+
+    if (bootRomPath.empty() == false && !application.setBootRom(bootRomPath)) return EXIT_FAILURE;
+    application.setColorCorrection(colorCorrection);
+    application.setScaling(filter, static_cast<uint8_t>(std::clamp(scale, 1, gMaxScale)));
+
+    if (recordPath.empty() == false) application.recordMovie(recordPath);
+    if (playPath.empty() == false && !application.playMovie(playPath, seekFrame)) return EXIT_FAILURE;
+
+    // the game runs on its own thread, paced frame by frame; this one presents the frames and sleeps otherwise
+    application.loadRom(gamePath);
+
+    while (!gTerminate && application.isRunning())
     {
-        const std::string gamePath = "foo";
-        std::thread gameThread = std::thread(&Application::loadRom, &application, gamePath);
+        application.loop();
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
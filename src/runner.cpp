@@ -0,0 +1,389 @@
+#include "Runner/BatchEnvironment.h"
+#include "Runner/MachineRunner.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// only this front end knows about signals; the runner gets the flag passed in
+static std::atomic<bool> gTerminate { false };
+
+static void requestTermination(int)
+{
+    gTerminate = true;
+}
+
+/*  usage: BoyColorRunner <rom> [options]
+        --instances <n>     machines running side by side; 1 by default
+        --threads <n>       worker threads; one per physical core by default
+        --frames <count>    frames every machine runs; 3600 by default
+        --draw              draws every frame instead of only emulating its timing
+        --env               steps the instances as a batch environment instead, with random buttons and a frame
+                            plus 16 bytes of work RAM as observation; --frames is the amount of steps then
+        --bench <name>      measures one thing on a single thread over --frames frames instead:
+                              apu         synthesis cost per second of audio, all four channels playing a
+                                          changing note every frame (the ROM is not used)
+                              audio-off   frames/s of the game with and without synthesis, with the same
+                                          notes playing on top
+                              states      save and load of a machine state, and the cost of a frame with
+                                          run-ahead 2 against a plain one
+                              fork        fork alone and fork + 1 frame + discard, from a machine and from a
+                                          fork of it that has run on
+*/
+
+static int runEnvironment(const std::string& gamePath, const size_t instanceCount, const size_t threadCount, const uint64_t stepCount)
+{
+    BatchEnvironment::Config config;
+    config.environmentCount = instanceCount;
+    config.threadCount = threadCount;
+    for (uint16_t address = 0xC000; address < 0xC010; address++)
+    {
+        config.observedAddresses.push_back(address);
+    }
+
+    BatchEnvironment environment(config);
+    environment.loadRom(gamePath);
+
+    std::vector<uint32_t> frames(instanceCount * gDisplayWidth * gDisplayHeight);
+    std::vector<uint8_t> memory(instanceCount * environment.observationSize());
+    std::vector<float> rewards(instanceCount);
+    std::vector<uint8_t> done(instanceCount);
+    environment.bindObservations({ frames.data(), memory.data(), rewards.data(), done.data() });
+
+    std::vector<uint8_t> actions(instanceCount);
+    uint32_t random = 0x9E3779B9;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t step = 0; step < stepCount && !gTerminate; step++)
+    {
+        for (uint8_t& action : actions)
+        {
+            // xorshift; the buttons only matter for the work they cause
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            action = static_cast<uint8_t>(random);
+        }
+
+        environment.step(actions.data());
+    }
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    const double stepsPerSecond = static_cast<double>(environment.stepCount()) / duration.count();
+    std::printf("%zu environments: %llu steps in %.3f s, %.1f env-steps/s\n", environment.environmentCount(),
+                static_cast<unsigned long long>(environment.stepCount()), duration.count(), stepsPerSecond);
+
+    return EXIT_SUCCESS;
+}
+
+static double secondsSince(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// all four channels on at full volume
+static void startChannels(Apu& apu)
+{
+    apu.writeRegister(soundControlRegister, 0x80);
+    apu.writeRegister(masterVolumeRegister, 0x77);
+    apu.writeRegister(soundPanningRegister, 0xFF);
+    for (uint16_t address = waveRamStart; address <= audioRegistersEnd; address++)
+    {
+        apu.writeRegister(address, static_cast<uint8_t>((address - waveRamStart) * 0x11));
+    }
+
+    apu.writeRegister(channel1LengthRegister, 0x80);
+    apu.writeRegister(channel2LengthRegister, 0x40);
+    apu.writeRegister(channel1EnvelopeRegister, 0xF3);
+    apu.writeRegister(channel2EnvelopeRegister, 0xA2);
+    apu.writeRegister(channel3DacRegister, 0x80);
+    apu.writeRegister(channel3VolumeRegister, 0x20);
+    apu.writeRegister(channel4EnvelopeRegister, 0xF1);
+    apu.writeRegister(channel4PolynomialRegister, 0x45);
+}
+
+// what a music driver does once per frame: new periods for every channel, retriggering the notes
+static void playNotes(Apu& apu, const uint64_t frame)
+{
+    const uint16_t period = static_cast<uint16_t>(0x400 + (frame * 37) % 0x3C0);
+    apu.writeRegister(channel1FrequencyRegister, period & 0xFF);
+    apu.writeRegister(channel1ControlRegister, 0x80 | (period >> 8));
+    apu.writeRegister(channel2FrequencyRegister, (period >> 1) & 0xFF);
+    apu.writeRegister(channel2ControlRegister, 0x80 | (period >> 9));
+    apu.writeRegister(channel3FrequencyRegister, (period * 3) & 0xFF);
+    apu.writeRegister(channel3ControlRegister, 0x80 | ((period * 3 >> 8) & 0b111));
+    if (frame % 8 == 0) apu.writeRegister(channel4ControlRegister, 0x80);
+}
+
+static int benchmarkApu(const uint64_t frameCount)
+{
+    Apu apu;
+    apu.setSynthesisEnabled(true);
+    startChannels(apu);
+
+    std::vector<int16_t> samples;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t frame = 0; frame < frameCount && !gTerminate; frame++)
+    {
+        playNotes(apu, frame);
+
+        apu.tick(static_cast<uint16_t>(cyclesPerFrame / 2));
+        apu.tick(static_cast<uint16_t>(cyclesPerFrame - cyclesPerFrame / 2));
+        apu.endFrame();
+
+        samples.resize(apu.samplesAvailable() * 2);
+        apu.readSamples(samples.data(), apu.samplesAvailable());
+    }
+
+    const double seconds = secondsSince(start);
+    const double audioSeconds = static_cast<double>(apu.statistics().cyclesSynthesized) / gClockRate;
+    std::printf("apu: %.1f s of audio at %u Hz in %.3f s; synthesis %.1f us per second of audio, %.1f us per second overall\n",
+                audioSeconds, apu.sampleRate(), seconds, apu.synthesisCostPerSecond().count() / 1000.0, seconds * 1e6 / audioSeconds);
+
+    return EXIT_SUCCESS;
+}
+
+static int benchmarkAudioOff(const std::string& gamePath, const uint64_t frameCount)
+{
+    double framesPerSecond[2] {};
+
+    for (const bool synthesis : { true, false })
+    {
+        auto machine = std::make_unique<Machine>();
+        machine->loadRom(gamePath);
+        machine->reset();
+        machine->ppu().setFrameSkipping(true);
+
+        Apu& apu = machine->apu();
+        apu.setSynthesisEnabled(synthesis);
+        startChannels(apu);
+
+        std::vector<int16_t> samples;
+        uint64_t frames = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (; frames < frameCount && !gTerminate; frames++)
+        {
+            // the notes play on top of the game, so there is something to synthesize even if it is silent
+            playNotes(apu, frames);
+            machine->runFrame();
+            apu.endFrame();
+
+            samples.resize(apu.samplesAvailable() * 2);
+            apu.readSamples(samples.data(), apu.samplesAvailable());
+        }
+
+        framesPerSecond[synthesis ? 0 : 1] = frames / secondsSince(start);
+    }
+
+    std::printf("audio-off: %.1f frames/s with synthesis, %.1f frames/s without, %.2fx\n", framesPerSecond[0], framesPerSecond[1],
+                framesPerSecond[1] / framesPerSecond[0]);
+
+    return EXIT_SUCCESS;
+}
+
+static int benchmarkStates(const std::string& gamePath, const uint64_t frameCount)
+{
+    // the frames run ahead per real frame, as with --run-ahead 2 in the front end
+    static constexpr uint8_t aheadFrames = 2;
+
+    auto machine = std::make_unique<Machine>();
+    machine->loadRom(gamePath);
+    machine->reset();
+    machine->ppu().setFrameSkipping(true);
+
+    // a state from within the game instead of the post-boot one
+    for (uint32_t frame = 0; frame < 60; frame++)
+    {
+        machine->runFrame();
+    }
+
+    std::vector<uint8_t> state;
+    machine->saveState(state);
+
+    uint64_t rounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (; rounds < frameCount && !gTerminate; rounds++)
+    {
+        machine->saveState(state);
+    }
+    // interrupted before anything was measured
+    if (rounds == 0) return EXIT_FAILURE;
+    const double saveTime = secondsSince(start) / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t round = 0; round < rounds; round++)
+    {
+        machine->loadState(state.data(), state.size());
+    }
+    const double loadTime = secondsSince(start) / rounds;
+
+    start = std::chrono::steady_clock::now();
+    for (uint64_t frame = 0; frame < rounds; frame++)
+    {
+        machine->runFrame();
+    }
+    const double frameTime = secondsSince(start) / rounds;
+
+    // the real frame, then the snapshot, the frames ahead and the restore
+    start = std::chrono::steady_clock::now();
+    for (uint64_t frame = 0; frame < rounds; frame++)
+    {
+        machine->runFrame();
+        machine->saveState(state);
+        for (uint8_t ahead = 0; ahead < aheadFrames; ahead++)
+        {
+            machine->runFrame();
+        }
+        machine->loadState(state.data(), state.size());
+    }
+    const double runAheadTime = secondsSince(start) / rounds;
+
+    std::printf("states: %zu bytes; save %.2f us, load %.2f us; frame %.1f us, with run-ahead %u %.1f us (snapshot and restore %.1f%%)\n",
+                state.size(), saveTime * 1e6, loadTime * 1e6, frameTime * 1e6, aheadFrames, runAheadTime * 1e6,
+                (saveTime + loadTime) * 100.0 / runAheadTime);
+
+    return EXIT_SUCCESS;
+}
+
+static int benchmarkFork(const std::string& gamePath, const uint64_t frameCount)
+{
+    auto root = std::make_unique<Machine>();
+    root->loadRom(gamePath);
+    root->reset();
+    root->ppu().setFrameSkipping(true);
+    for (uint32_t frame = 0; frame < 60; frame++)
+    {
+        root->runFrame();
+    }
+
+    // tree search forks from machines that are forks themselves and have run on since
+    std::unique_ptr<Machine> node = root->fork();
+    node->ppu().setFrameSkipping(true);
+    node->runFrame();
+
+    // any game changes its RAM within a frame; a ROM used for measuring might not
+    node->memory().writeToMemoryAddress(wRamMemoryStart, 0x5A);
+    node->memory().writeToMemoryAddress(vRamMemoryStart, 0x5A);
+
+    for (const Machine* parent : { static_cast<const Machine*>(root.get()), static_cast<const Machine*>(node.get()) })
+    {
+        const char* name = parent == root.get() ? "root" : "fork";
+
+        Machine child;
+        uint64_t rounds = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (; rounds < frameCount && !gTerminate; rounds++)
+        {
+            child.forkFrom(*parent);
+        }
+        // interrupted before anything was measured
+        if (rounds == 0) return EXIT_FAILURE;
+        const double forkTime = secondsSince(start) / rounds;
+
+        // the search step: branch, play one frame, throw the branch away
+        start = std::chrono::steady_clock::now();
+        for (uint64_t round = 0; round < rounds; round++)
+        {
+            std::unique_ptr<Machine> branch = parent->fork();
+            branch->ppu().setFrameSkipping(true);
+            branch->runFrame();
+        }
+        const double branchTime = secondsSince(start) / rounds;
+
+        std::printf("fork from %s: forkFrom %.2f us; fork + 1 frame + discard %.1f us, %.0f per second\n", name, forkTime * 1e6,
+                    branchTime * 1e6, 1.0 / branchTime);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int runBenchmark(const std::string& name, const std::string& gamePath, const uint64_t frameCount)
+{
+    if (frameCount == 0) return EXIT_FAILURE;
+
+    if (name == "apu") return benchmarkApu(frameCount);
+    if (name == "audio-off") return benchmarkAudioOff(gamePath, frameCount);
+    if (name == "states") return benchmarkStates(gamePath, frameCount);
+    if (name == "fork") return benchmarkFork(gamePath, frameCount);
+
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) return EXIT_FAILURE;
+
+    const std::string gamePath = argv[1];
+
+    size_t instanceCount = 1;
+    size_t threadCount = 0;
+    uint64_t frameCount = 3600;
+    bool draw = false;
+    bool environment = false;
+    std::string benchmark;
+
+    for (int index = 2; index < argc; index++)
+    {
+        const std::string option = argv[index];
+        const bool hasValue = index + 1 < argc;
+
+        if (option == "--draw")
+        {
+            draw = true;
+        }
+        else if (option == "--env")
+        {
+            environment = true;
+        }
+        else if (option == "--bench" && hasValue)
+        {
+            benchmark = argv[++index];
+        }
+        else if (option == "--instances" && hasValue)
+        {
+            instanceCount = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (option == "--threads" && hasValue)
+        {
+            threadCount = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else if (option == "--frames" && hasValue)
+        {
+            frameCount = std::strtoull(argv[++index], nullptr, 10);
+        }
+        else
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (instanceCount == 0) return EXIT_FAILURE;
+
+    std::signal(SIGINT, requestTermination);
+    std::signal(SIGTERM, requestTermination);
+
+    if (benchmark.empty() == false) return runBenchmark(benchmark, gamePath, frameCount);
+    if (environment) return runEnvironment(gamePath, instanceCount, threadCount, frameCount);
+
+    MachineRunner runner(instanceCount, threadCount);
+
+    // like the windowed front end, a missing ROM leaves the machines running on open bus
+    runner.loadRom(gamePath);
+    runner.setDrawing(draw);
+
+    const MachineRunner::Statistics statistics = runner.run(frameCount, &gTerminate);
+
+    const double seconds = static_cast<double>(statistics.duration.count()) / 1e9;
+    std::printf("%zu instances on %zu threads: %llu frames in %.3f s, %.1f frames/s (%.1f per instance)\n",
+                runner.machineCount(), runner.threadCount(), static_cast<unsigned long long>(statistics.frames), seconds,
+                statistics.framesPerSecond(), statistics.framesPerSecond() / static_cast<double>(runner.machineCount()));
+    std::printf("%zu bytes of state per instance\n", sizeof(Machine));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "../src/Hardware/Machine/Machine.h"
+#include "../src/Hardware/Memory/MemoryDefines.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+/*  what running a machine allocates, and forks sharing its RAM. Machine.cpp bounds the size from above; the
+    actual size depends on the standard library and is only printed.
+    Every frame writes a few bytes of work and video RAM before it runs, on a machine and on a fork of it, and
+    every allocation made meanwhile is counted. The fork has to copy the pages it writes back out of the shared
+    memory, and neither machine may see the other's writes.
+*/
+
+static constexpr uint32_t gFrameCount = 60;
+
+// a page of work RAM and one of tile data in video RAM, both well inside their own pages
+static constexpr uint16_t gWorkRamAddress = 0xC000;
+static constexpr uint16_t gVideoRamAddress = 0x8000;
+static constexpr uint8_t gWrittenPages = 2;
+
+static std::atomic<uint64_t> gAllocations {};
+
+void* operator new(const size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// a GBC cartridge that halts right away; the test does the writing
+static std::shared_ptr<const Machine::Rom> makeRom()
+{
+    auto rom = std::make_shared<Machine::Rom>();
+    rom->data.resize(0x8000);
+    rom->data[0x100] = 0x76; // halt
+    rom->data[cartridgeColorFlag] = 0x80;
+    return rom;
+}
+
+// writes value + frame to a byte of each page before every frame; returns the allocations made meanwhile
+static uint64_t runFrames(Machine& machine, const uint8_t value)
+{
+    const uint64_t before = gAllocations.load(std::memory_order_relaxed);
+    for (uint32_t frame = 0; frame < gFrameCount; frame++)
+    {
+        // a frame ends in vertical blank, where video RAM is accessible
+        machine.memory().writeToMemoryAddress(gWorkRamAddress + frame, static_cast<uint8_t>(value + frame));
+        machine.memory().writeToMemoryAddress(gVideoRamAddress + frame, static_cast<uint8_t>(value + frame));
+        machine.runFrame();
+    }
+
+    return gAllocations.load(std::memory_order_relaxed) - before;
+}
+
+// whether every byte written by runFrames with this value reads back
+static bool holds(Machine& machine, const uint8_t value)
+{
+    for (uint32_t frame = 0; frame < gFrameCount; frame++)
+    {
+        if (machine.memory().getMemoryAtAddress(gWorkRamAddress + frame) != static_cast<uint8_t>(value + frame)) return false;
+        if (machine.memory().getMemoryAtAddress(gVideoRamAddress + frame) != static_cast<uint8_t>(value + frame)) return false;
+    }
+
+    return true;
+}
+
+static bool check(const char* name, const bool ok)
+{
+    std::printf("%-44s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    bool passed = true;
+
+    std::printf("machine size: %zu bytes\n", sizeof(Machine));
+
+    auto machine = std::make_unique<Machine>();
+    machine->setRom(makeRom());
+    machine->reset();
+
+    const uint64_t machineAllocations = runFrames(*machine, 0x10);
+    std::printf("running %u frames: %llu allocations\n", gFrameCount, static_cast<unsigned long long>(machineAllocations));
+    passed &= check("running allocates nothing", machineAllocations == 0);
+    passed &= check("the machine holds its writes", holds(*machine, 0x10));
+
+    // the fork shares both pages with the machine and has to copy them back out on its first writes
+    std::unique_ptr<Machine> child = machine->fork();
+    passed &= check("the fork starts out with the machine's RAM", holds(*child, 0x10));
+
+    const uint64_t copiedBefore = child->memory().copiedPages();
+    const uint64_t childAllocations = runFrames(*child, 0x80);
+    const uint64_t copiedPages = child->memory().copiedPages() - copiedBefore;
+    std::printf("running %u frames of the fork: %llu allocations, %llu pages copied\n", gFrameCount,
+                static_cast<unsigned long long>(childAllocations), static_cast<unsigned long long>(copiedPages));
+    passed &= check("running the fork allocates nothing", childAllocations == 0);
+    passed &= check("the fork copies each written page once", copiedPages == gWrittenPages);
+
+    // the machine only copies the pages back once it writes them itself
+    const uint64_t machineCopiedBefore = machine->memory().copiedPages();
+    runFrames(*machine, 0x40);
+    passed &= check("the machine copies each written page once", machine->memory().copiedPages() - machineCopiedBefore == gWrittenPages);
+
+    passed &= check("the fork keeps its own writes", holds(*child, 0x80));
+    passed &= check("the machine keeps its own writes", holds(*machine, 0x40));
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
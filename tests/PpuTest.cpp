@@ -0,0 +1,81 @@
+#include "../src/Hardware/Machine/Machine.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+/*  the PPU's line cache across state loads, the way run-ahead uses them: save, run a hidden frame, load, run
+    the shown frame. A static screen has to skip every line of the shown frame; a load that puts back different
+    video memory has to draw exactly the lines showing it.
+*/
+
+static constexpr uint8_t gFrameCount = 10;
+
+// a cartridge that halts right away; with no interrupt enabled the screen never changes
+static std::shared_ptr<const Machine::Rom> makeRom()
+{
+    auto rom = std::make_shared<Machine::Rom>();
+    rom->data.resize(0x8000);
+    rom->data[0x100] = 0x76; // halt
+    return rom;
+}
+
+// a hidden run-ahead frame followed by the shown one
+static Ppu::FrameStatistics runAheadFrame(Machine& machine, std::vector<uint8_t>& state)
+{
+    machine.saveState(state);
+
+    machine.ppu().setFrameSkipping(true);
+    machine.runFrame();
+    machine.ppu().setFrameSkipping(false);
+
+    machine.loadState(state.data(), state.size());
+    machine.runFrame();
+    return machine.ppu().lastFrameStatistics();
+}
+
+static bool check(const char* name, const Ppu::FrameStatistics& statistics, const uint8_t expectedRendered)
+{
+    const bool ok = statistics.linesRendered == expectedRendered && statistics.linesSkipped == gDisplayHeight - expectedRendered;
+    std::printf("%-36s %3u lines rendered, %3u skipped (expected %u rendered) %s\n", name, statistics.linesRendered,
+                statistics.linesSkipped, expectedRendered, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    bool passed = true;
+
+    auto displayData = std::make_unique<DisplayData>();
+    auto machine = std::make_unique<Machine>();
+    machine->setRom(makeRom());
+    machine->reset();
+    machine->ppu().setDisplayBuffer(*displayData, 0);
+
+    // the first frames draw every line once
+    machine->runFrame();
+    machine->runFrame();
+    passed &= check("static screen", machine->ppu().lastFrameStatistics(), 0);
+
+    std::vector<uint8_t> state;
+    for (uint8_t frame = 0; frame < gFrameCount; frame++)
+    {
+        passed &= check("static screen under run-ahead", runAheadFrame(*machine, state), 0);
+    }
+
+    // the first row of the background map covers the first eight lines
+    machine->saveState(state);
+    machine->memory().writeToMemoryAddress(0x9800, 1);
+    machine->runFrame();
+    passed &= check("tile map row written", machine->ppu().lastFrameStatistics(), 8);
+
+    machine->loadState(state.data(), state.size());
+    machine->runFrame();
+    passed &= check("tile map row restored by a load", machine->ppu().lastFrameStatistics(), 8);
+
+    machine->runFrame();
+    passed &= check("static screen after the load", machine->ppu().lastFrameStatistics(), 0);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
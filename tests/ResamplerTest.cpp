@@ -0,0 +1,102 @@
+#include "../src/Audio/Resampler.h"
+#include "../src/Hardware/APU/ApuDefines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*  frequency response of the resampler from the APU rate to 48 kHz. Steps a sine through the passband and the
+    stopband at every quality and checks the gain against the bounds below.
+    The stopband starts where aliases would land below 20 kHz; above 20 kHz nothing is audible anyway.
+*/
+
+static constexpr uint32_t gOutputRate = 48000;
+static constexpr double gStopbandStart = 28000.0;
+static constexpr double gAmplitude = 16384.0;
+
+// APU output arrives in frame-sized blocks
+static constexpr size_t gBlockSize = 1097;
+
+struct Bounds
+{
+    Resampler::Quality quality;
+    const char* name;
+    double passbandEnd; // Hz
+    double maxRipple; // dB, either direction
+    double minAttenuation; // dB
+};
+
+static constexpr Bounds gBounds[] =
+{
+    { Resampler::Quality::fast, "fast", 4000.0, 0.5, 15.0 },
+    { Resampler::Quality::balanced, "balanced", 12000.0, 0.5, 24.0 },
+    { Resampler::Quality::best, "best", 16000.0, 0.1, 45.0 }
+};
+
+// gain in dB of a sine at the given frequency; the start of the output, where the filter fills, is not measured
+static double measureGain(const Resampler::Quality quality, const double frequency)
+{
+    static constexpr double pi = 3.14159265358979323846;
+
+    Resampler resampler;
+    resampler.configure(apuSampleRate, gOutputRate, quality);
+
+    const size_t inputCount = apuSampleRate / 4;
+    std::vector<int16_t> input(inputCount * 2);
+    for (size_t index = 0; index < inputCount; index++)
+    {
+        const int16_t value = static_cast<int16_t>(std::lround(gAmplitude * std::sin(2.0 * pi * frequency * index / apuSampleRate)));
+        input[index * 2] = value;
+        input[index * 2 + 1] = value;
+    }
+
+    std::vector<int16_t> output;
+    for (size_t start = 0; start < inputCount; start += gBlockSize)
+    {
+        resampler.process(&input[start * 2], std::min(gBlockSize, inputCount - start), output);
+    }
+
+    const size_t outputCount = output.size() / 2;
+    double leftSum = 0.0;
+    double rightSum = 0.0;
+    for (size_t index = outputCount / 4; index < outputCount; index++)
+    {
+        leftSum += static_cast<double>(output[index * 2]) * output[index * 2];
+        rightSum += static_cast<double>(output[index * 2 + 1]) * output[index * 2 + 1];
+    }
+
+    const size_t measured = outputCount - outputCount / 4;
+    const double rms = std::sqrt(std::max(leftSum, rightSum) / measured);
+    return 20.0 * std::log10(std::max(rms, 1e-3) / (gAmplitude / std::sqrt(2.0)));
+}
+
+int main()
+{
+    bool passed = true;
+
+    for (const Bounds& bounds : gBounds)
+    {
+        double maxRipple = 0.0;
+        for (double frequency = 100.0; frequency <= bounds.passbandEnd; frequency += 100.0)
+        {
+            maxRipple = std::max(maxRipple, std::abs(measureGain(bounds.quality, frequency)));
+        }
+
+        double minAttenuation = 1000.0;
+        for (double frequency = gStopbandStart; frequency < apuSampleRate / 2; frequency += 250.0)
+        {
+            minAttenuation = std::min(minAttenuation, -measureGain(bounds.quality, frequency));
+        }
+
+        const bool ok = maxRipple <= bounds.maxRipple && minAttenuation >= bounds.minAttenuation;
+        std::printf("%-8s passband 0.1 - %.0f kHz: ripple %.3f dB (max %.2f); stopband from %.0f kHz: %.1f dB (min %.1f) %s\n",
+                    bounds.name, bounds.passbandEnd / 1000.0, maxRipple, bounds.maxRipple, gStopbandStart / 1000.0,
+                    minAttenuation, bounds.minAttenuation, ok ? "ok" : "FAILED");
+
+        passed &= ok;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
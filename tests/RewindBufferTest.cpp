@@ -0,0 +1,138 @@
+#include "../src/Hardware/SaveState/RewindBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/*  the rewind ring against a plain list of everything pushed. States drift by a few random bytes per frame,
+    now and then by a burst. Every ring wraps; the small ones lose their keyframe within a keyframe interval.
+    Every state rewinding hands out has to be byte-identical to the one pushed at that point, newest first,
+    also after rewinding part of the way and pushing on from there.
+*/
+
+static constexpr size_t gStateSize = 4096;
+static constexpr uint32_t gPushCount = 600;
+
+struct Scenario
+{
+    const char* name;
+    size_t capacity;
+    uint32_t changedBytes; // per frame
+    uint32_t seed;
+};
+
+static constexpr Scenario gScenarios[] =
+{
+    { "calm, large ring", 256 * 1024, 4, 1 },
+    { "calm, small ring", 24 * 1024, 4, 2 },
+    { "busy, small ring", 24 * 1024, 96, 3 },
+    { "busy, tiny ring", 3 * gStateSize, 96, 4 }
+};
+
+class StateSource
+{
+public:
+    explicit StateSource(const uint32_t seed)
+        : mRandom(seed),
+          mState(gStateSize)
+    {
+        // half the state never changes, like most of a machine's RAM
+        for (size_t index = 0; index < gStateSize / 2; index++)
+        {
+            mState[index] = static_cast<uint8_t>(mRandom());
+        }
+    }
+
+    const std::vector<uint8_t>& next(const uint32_t changedBytes)
+    {
+        const uint32_t count = mRandom() % 16 == 0 ? changedBytes * 8 : changedBytes;
+        for (uint32_t change = 0; change < count; change++)
+        {
+            mState[gStateSize / 2 + mRandom() % (gStateSize / 2)] = static_cast<uint8_t>(mRandom());
+        }
+        return mState;
+    }
+
+    uint32_t random() { return static_cast<uint32_t>(mRandom()); }
+
+private:
+    std::mt19937 mRandom;
+    std::vector<uint8_t> mState;
+};
+
+// pops count states (all if count is 0) and compares them with the newest ones pushed, which they replace
+static bool rewind(RewindBuffer& buffer, std::vector<std::vector<uint8_t>>& pushed, const size_t count, size_t& popped)
+{
+    const size_t available = buffer.stateCount();
+    const size_t wanted = count == 0 ? available : std::min(count, available);
+
+    buffer.beginRewind();
+
+    std::vector<uint8_t> state;
+    bool identical = true;
+    for (popped = 0; popped < wanted; popped++)
+    {
+        if (buffer.popState(state) == false) break;
+
+        identical &= state == pushed.back();
+        pushed.pop_back();
+    }
+
+    // the history ends exactly where the count said
+    const bool ended = count != 0 || buffer.popState(state) == false;
+    buffer.endRewind();
+
+    return identical && popped == wanted && ended;
+}
+
+static bool runScenario(const Scenario& scenario)
+{
+    RewindBuffer buffer;
+    buffer.setCapacity(scenario.capacity);
+
+    StateSource source(scenario.seed);
+    std::vector<std::vector<uint8_t>> pushed;
+
+    bool ok = true;
+    size_t partialPops = 0;
+    for (uint32_t push = 0; push < gPushCount; push++)
+    {
+        pushed.push_back(source.next(scenario.changedBytes));
+        buffer.push(pushed.back());
+
+        ok &= buffer.stateCount() > 0 && buffer.usedBytes() <= buffer.capacity();
+
+        // now and then rewind a little and carry on from there, overwriting what was popped
+        if (source.random() % 50 == 0)
+        {
+            size_t popped = 0;
+            ok &= rewind(buffer, pushed, 1 + source.random() % 20, popped);
+            partialPops += popped;
+        }
+    }
+
+    const size_t history = buffer.stateCount();
+    size_t popped = 0;
+    ok &= rewind(buffer, pushed, 0, popped);
+
+    // every ring is too small for all pushes, so it has to have wrapped and dropped old states
+    const bool wrapped = history < gPushCount - partialPops;
+    ok &= wrapped;
+
+    std::printf("%-18s %7zu B ring: %3zu states in the history, %3zu popped on the way %s\n", scenario.name,
+                scenario.capacity, history, partialPops, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    bool passed = true;
+    for (const Scenario& scenario : gScenarios)
+    {
+        passed &= runScenario(scenario);
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
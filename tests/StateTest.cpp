@@ -0,0 +1,124 @@
+#include "../src/Hardware/Machine/Machine.h"
+#include "../src/Hardware/SaveState/StateBuffer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*  save states: saving, loading and saving again gives the same bytes; a state that turns out broken while
+    loading, or was written with other fields than this build reads, must leave the machine as it was.
+*/
+
+static constexpr uint32_t gFrameCount = 30;
+
+// a cartridge that halts right away; the test writes the RAM itself
+static std::shared_ptr<const Machine::Rom> makeRom()
+{
+    auto rom = std::make_shared<Machine::Rom>();
+    rom->data.resize(0x8000);
+    rom->data[0x100] = 0x76; // halt
+    return rom;
+}
+
+static std::unique_ptr<Machine> makeMachine(const std::shared_ptr<const Machine::Rom>& rom, const uint8_t value)
+{
+    auto machine = std::make_unique<Machine>();
+    machine->setRom(rom);
+    machine->reset();
+
+    for (uint32_t frame = 0; frame < gFrameCount; frame++)
+    {
+        machine->memory().writeToMemoryAddress(0xC000 + frame, static_cast<uint8_t>(value + frame));
+        machine->memory().writeToMemoryAddress(0x8000 + frame, static_cast<uint8_t>(value + frame));
+        machine->runFrame();
+    }
+
+    return machine;
+}
+
+static bool check(const char* name, const bool ok)
+{
+    std::printf("%-48s %s\n", name, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// whether a reader reading First then Second ends up with the layout of a writer that wrote uint8_t then uint32_t
+template <typename First, typename Second>
+static bool readsLikeWritten()
+{
+    std::vector<uint8_t> buffer;
+    StateWriter writer(buffer);
+    writer.write(uint8_t {});
+    writer.write(uint32_t {});
+
+    StateReader reader(buffer.data(), buffer.size());
+    First first {};
+    Second second {};
+    reader.read(first);
+    reader.read(second);
+    return reader.failed() == false && reader.layout() == writer.layout();
+}
+
+// a state whose header claims another layout
+static std::vector<uint8_t> withLayout(const std::vector<uint8_t>& state, const uint32_t layout)
+{
+    std::vector<uint8_t> changed = state;
+    Machine::StateHeader header {};
+    std::memcpy(&header, changed.data(), sizeof(header));
+    header.layout = layout;
+    std::memcpy(changed.data(), &header, sizeof(header));
+    return changed;
+}
+
+int main()
+{
+    bool passed = true;
+
+    const std::shared_ptr<const Machine::Rom> rom = makeRom();
+    std::unique_ptr<Machine> source = makeMachine(rom, 0x10);
+    std::unique_ptr<Machine> target = makeMachine(rom, 0x80);
+
+    std::vector<uint8_t> sourceState;
+    std::vector<uint8_t> targetState;
+    source->saveState(sourceState);
+    target->saveState(targetState);
+
+    // cut off in the middle of the payload, with a header that agrees, so only reading the payload finds out
+    std::vector<uint8_t> truncated(sourceState.begin(), sourceState.begin() + sourceState.size() / 2);
+    Machine::StateHeader header {};
+    std::memcpy(&header, truncated.data(), sizeof(header));
+    header.payloadSize = static_cast<uint32_t>(truncated.size() - sizeof(header));
+    std::memcpy(truncated.data(), &header, sizeof(header));
+
+    std::vector<uint8_t> afterwards;
+    passed &= check("a truncated payload is rejected", target->loadState(truncated.data(), truncated.size()) == false);
+    target->saveState(afterwards);
+    passed &= check("a rejected state leaves the machine as it was", afterwards == targetState);
+
+    std::memcpy(&header, sourceState.data(), sizeof(header));
+    const std::vector<uint8_t> otherLayout = withLayout(sourceState, header.layout + 1);
+    passed &= check("a state of another layout is rejected", target->loadState(otherLayout.data(), otherLayout.size()) == false);
+    target->saveState(afterwards);
+    passed &= check("which leaves the machine as it was", afterwards == targetState);
+
+    passed &= check("the complete state loads", target->loadState(sourceState.data(), sourceState.size()));
+    target->saveState(afterwards);
+    passed &= check("the loaded machine saves the same bytes", afterwards == sourceState);
+
+    // a new machine has nothing of its own left over that could mask a field the state misses
+    auto fresh = std::make_unique<Machine>();
+    fresh->setRom(rom);
+    passed &= check("a new machine loads the state", fresh->loadState(sourceState.data(), sourceState.size()));
+    fresh->saveState(afterwards);
+    passed &= check("and saves the same bytes", afterwards == sourceState);
+
+    // fields that keep the size of the state but change what it means
+    passed &= check("the layout follows the fields", readsLikeWritten<uint8_t, uint32_t>());
+    passed &= check("and their order", readsLikeWritten<uint32_t, uint8_t>() == false);
+    passed &= check("and their types", readsLikeWritten<int8_t, uint32_t>() == false && readsLikeWritten<bool, uint32_t>() == false
+                                     && readsLikeWritten<uint8_t, float>() == false);
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
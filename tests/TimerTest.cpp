@@ -0,0 +1,186 @@
+#include "../src/Hardware/Memory/MemoryDefines.h"
+#include "../src/Hardware/Timer/Timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+/*  the lazy timer against a naive one that steps a 16-bit divider every cycle and counts the falling edges of
+    the selected bit, as the hardware does. Both get the same random register writes: DIV writes that make the
+    selected bit fall, TAC switches of the input and the enable, TMA values close to 0xFF so TIMA keeps wrapping
+    through it at the fastest rate.
+    In the event run the lazy timer is only touched at its own overflow events and at writes, the way the
+    memory polls it; every overflow has to fall on the same cycle as in the naive timer. In the sparse run it is
+    brought up to date only now and then, across several overflows at once.
+*/
+
+static constexpr uint64_t gCycleCount = 4000000;
+
+// the naive timer: everything happens per cycle
+class ReferenceTimer
+{
+public:
+    // advances one cycle; returns true on overflow
+    bool step()
+    {
+        const bool before = input();
+        mDivider++;
+        return before && input() == false && increment();
+    }
+
+    // returns true on overflow
+    bool write(const uint16_t address, const uint8_t value)
+    {
+        const bool before = input();
+        switch (address)
+        {
+            case dividerRegister: mDivider = 0; break;
+            case timerCounterRegister: mCounter = value; return false;
+            case timerModuloRegister: mModulo = value; return false;
+            case timerControlRegister: mControl = value & 0b111; break;
+        }
+
+        return before && input() == false && increment();
+    }
+
+    uint8_t read(const uint16_t address) const
+    {
+        switch (address)
+        {
+            case dividerRegister: return static_cast<uint8_t>(mDivider >> 8);
+            case timerCounterRegister: return mCounter;
+            case timerModuloRegister: return mModulo;
+            default: return 0b11111000 | mControl;
+        }
+    }
+
+private:
+    bool input() const
+    {
+        static constexpr uint8_t inputBits[] = { 9, 3, 5, 7 };
+        return (mControl & 0b100) && ((mDivider >> inputBits[mControl & 0b11]) & 0b1);
+    }
+
+    bool increment()
+    {
+        if (++mCounter != 0) return false;
+
+        mCounter = mModulo;
+        return true;
+    }
+
+    uint16_t mDivider {};
+    uint8_t mCounter {};
+    uint8_t mModulo {};
+    uint8_t mControl {};
+};
+
+struct Write
+{
+    uint16_t address;
+    uint8_t value;
+};
+
+// mostly TAC and DIV, with values that keep the timer busy
+static Write randomWrite(std::mt19937& random)
+{
+    const uint32_t kind = random() % 8;
+    const uint8_t value = static_cast<uint8_t>(random());
+    switch (kind)
+    {
+        case 0:
+        case 1: return { dividerRegister, value };
+        case 2: return { timerCounterRegister, static_cast<uint8_t>(value | 0xF0) };
+        case 3: return { timerModuloRegister, random() % 2 ? static_cast<uint8_t>(0xFF - value % 4) : value };
+        default: return { timerControlRegister, value };
+    }
+}
+
+static bool sameRegisters(Timer& timer, const ReferenceTimer& reference, const uint64_t now)
+{
+    timer.update(now);
+    for (uint16_t address = dividerRegister; address <= timerControlRegister; address++)
+    {
+        if (timer.readRegister(address, now) != reference.read(address)) return false;
+    }
+
+    return true;
+}
+
+// returns the number of cycles the two timers disagreed on
+static uint64_t compare(const uint32_t seed, const bool sparse, uint64_t& overflows)
+{
+    std::mt19937 random(seed);
+
+    Timer timer;
+    timer.reset(0);
+    ReferenceTimer reference;
+
+    uint64_t mismatches = 0;
+    uint64_t nextWrite = random() % 2000;
+    uint64_t nextPoll = random() % 5000;
+    bool referencePending = false; // an overflow the sparse run has not polled yet
+
+    for (uint64_t now = 1; now <= gCycleCount; now++)
+    {
+        bool referenceOverflow = reference.step();
+        bool timerOverflow = false;
+
+        if (sparse == false && now >= timer.nextEvent()) timerOverflow = timer.update(now);
+
+        const bool writing = now == nextWrite;
+        if (writing)
+        {
+            const Write write = randomWrite(random);
+            referenceOverflow |= reference.write(write.address, write.value);
+            timerOverflow |= timer.writeRegister(write.address, write.value, now);
+            nextWrite = now + 1 + random() % 2000;
+        }
+
+        overflows += referenceOverflow;
+        if (sparse)
+        {
+            // a write brings the timer up to date as well. Either only tells whether anything overflowed since
+            // the timer was last brought up to date
+            referencePending |= referenceOverflow;
+            const bool polling = now == nextPoll;
+            if (polling)
+            {
+                timerOverflow |= timer.update(now);
+                nextPoll = now + 1 + random() % 5000;
+            }
+            if (writing || polling)
+            {
+                mismatches += timerOverflow != referencePending || sameRegisters(timer, reference, now) == false;
+                referencePending = false;
+            }
+        }
+        else
+        {
+            mismatches += timerOverflow != referenceOverflow;
+            if (now % 97 == 0) mismatches += sameRegisters(timer, reference, now) == false;
+        }
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    bool passed = true;
+
+    for (uint32_t seed = 1; seed <= 4; seed++)
+    {
+        for (const bool sparse : { false, true })
+        {
+            uint64_t overflows = 0;
+            const uint64_t mismatches = compare(seed, sparse, overflows);
+            std::printf("seed %u, %-6s run: %7llu overflows, %llu mismatches %s\n", seed, sparse ? "sparse" : "event",
+                        static_cast<unsigned long long>(overflows), static_cast<unsigned long long>(mismatches),
+                        mismatches == 0 ? "ok" : "FAILED");
+            passed &= mismatches == 0;
+        }
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}